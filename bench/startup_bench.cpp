@@ -0,0 +1,104 @@
+﻿#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+//Qt
+#include <QCoreApplication>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDir>
+
+//...............................................................................................................
+// startup_bench - time from exec of ts_tool to the moment it starts reading its input.
+// Runs ts_tool --mode TXT on a tiny .ts many times, passing the steady clock at start in TS_TOOL_BENCH_T0,
+// ts_tool prints "startup_us=N" to stderr (see report_startup_latency() in main.cpp).
+//
+// usage: startup_bench <path to ts_tool> [runs, default 200]
+//...............................................................................................................
+
+static const char tiny_ts[] =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<!DOCTYPE TS>\n"
+    "<TS version=\"2.1\" language=\"en_US\">\n"
+    "<context>\n"
+    "    <name>Bench</name>\n"
+    "    <message>\n"
+    "        <location filename=\"bench.cpp\" line=\"1\"/>\n"
+    "        <source>Hello</source>\n"
+    "        <translation>Hello</translation>\n"
+    "    </message>\n"
+    "</context>\n"
+    "</TS>\n";
+
+long long percentile(std::vector<long long> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, size_t(p * values.size()))];
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    if(argc < 2) {
+        std::cout << "usage: startup_bench <path to ts_tool> [runs]" << std::endl;
+        return -1;
+    }
+
+    const QString tool = QString::fromLocal8Bit(argv[1]);
+    const int runs = 2 < argc ? std::max(1, atoi(argv[2])) : 200;
+
+    QTemporaryDir dir;
+    const QString input = dir.path() + "/bench.ts", output = dir.path() + "/out";
+
+    QFile ts(input);
+    if(!ts.open(QIODevice::WriteOnly) || -1 == ts.write(tiny_ts)) {
+        std::cout << "Cant create " << input.toUtf8().constData() << std::endl;
+        return -1;
+    }
+    ts.close();
+
+    std::vector<long long> startup_us, total_us;
+    startup_us.reserve(runs);
+    total_us.reserve(runs);
+
+    for(int n = 0; n < runs; ++n)
+    {
+        QProcess process;
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+
+        const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        env.insert("TS_TOOL_BENCH_T0", QString::number(std::chrono::duration_cast<std::chrono::nanoseconds>(t0.time_since_epoch()).count()));
+        process.setProcessEnvironment(env);
+
+        process.start(tool, QStringList() << "--src" << input << "--dst" << output << "--mode" << "TXT");
+        if(!process.waitForFinished(-1) || 0 != process.exitCode())
+        {
+            std::cout << "ts_tool failed: " << process.readAllStandardOutput().constData() << std::endl;
+            return -1;
+        }
+
+        total_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count());
+
+        const QByteArray err = process.readAllStandardError();
+        const int pos = err.indexOf("startup_us=");
+        if(-1 == pos)
+        {
+            std::cout << "ts_tool does not report startup_us, too old?" << std::endl;
+            return -1;
+        }
+
+        const int eol = err.indexOf('\n', pos);
+        startup_us.push_back(err.mid(pos + 11, -1 == eol ? -1 : eol - pos - 11).trimmed().toLongLong());
+    }
+
+    std::cout << "runs: " << runs << std::endl;
+    std::cout << "exec -> input read, us:  min " << percentile(startup_us, 0) << "  median " << percentile(startup_us, 0.5) << "  p90 " << percentile(startup_us, 0.9) << std::endl;
+    std::cout << "exec -> exit, us:        min " << percentile(total_us, 0) << "  median " << percentile(total_us, 0.5) << "  p90 " << percentile(total_us, 0.9) << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+TARGET = startup_bench
+CONFIG += core console c++11
+TEMPLATE = app
+
+#-------------------------------------------------------------------------------------
+GENF_ROOT   = ../_output
+BIN_OUTPUT  = $${GENF_ROOT}/_bin
+#-------------------------------------------------------------------------------------
+
+CONFIG(release, debug|release) {
+    BUILD_TYPE = release
+} else {
+    BUILD_TYPE = debug
+}
+
+DESTDIR     = $${BIN_OUTPUT}/$${BUILD_TYPE}
+OBJECTS_DIR = $${GENF_ROOT}/$${TARGET}/$${BUILD_TYPE}/_build
+MOC_DIR     = $${GENF_ROOT}/$${TARGET}/$${BUILD_TYPE}/_moc
+
+##-------------------------------------------------------------------------------------
+
+SOURCES += \
+    ./startup_bench.cpp
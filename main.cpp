@@ -2,25 +2,23 @@
 #include <assert.h>
 #include <algorithm>
 #include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 
-//model
-#include "ts_model.h"
+//core
+#include "ts_core.h"
+#include "ts_watch.h"
+#include "ts_checks.h"
 
 //Qt
 #include <QString>
+#include <QStringList>
 #include <QCoreApplication>
-#include <QXmlStreamReader>
-#include <QXmlStreamWriter>
-#include <QTextStream>
-#include <QRegularExpression>
-#include <QFileInfo>
-#include <QDir>
+#include <QFile>
 
 #define VERSION "2.6"
 
-void toTXT(const QString &inputFile, const QString &outputDir, bool with_unfinished, bool with_vanished, bool unfinished_only);
-void toTS(const QString &inputDir, const QString &outputFile, const QString &langid);
-
 //SHOULD BE IN SAME ORDER AS in args[]
 enum EArgID {
       arg_unknown = -1
@@ -32,6 +30,12 @@ enum EArgID {
     , arg_with_unfinished
     , arg_with_vanished
     , arg_unfinished_only
+    , arg_watch
+    , arg_context
+    , arg_location
+    , arg_checks
+    , arg_check_report
+    , arg_fail_on_check
 };
 
 struct argument_info
@@ -52,8 +56,34 @@ static const argument_info args[] = {
     ,   {arg_with_unfinished, "--with-unfinished", "Include unfinished translations. By default: ignore. [Work only in TXT mode]", true}
     ,   {arg_with_vanished, "--with-vanished", "Include obsolete translations. By default: ignore. [Work only in TXT mode]", true}
     ,   {arg_unfinished_only, "--unfinished-only", "Only unfinished records. By default: ignore. [Work only in TXT mode]", true}
+    ,   {arg_watch, "--watch", "Keep running and redo the conversion every time --src changes. Several --src/--dst pairs may be given, in TXT mode --src may be a directory of .ts files", true}
+    ,   {arg_context, "--context", "Only messages of contexts matching the wildcard, for example: Main*. [Work only in TXT mode]", false}
+    ,   {arg_location, "--location", "Only messages with a <location filename> matching the wildcard, for example: */dialogs/*. [Work only in TXT mode]", false}
+    ,   {arg_checks, "--checks", "Check placeholders, accelerators and markup of merged translations, severities: placeholders=error,accelerators=warning,markup=warning (default), off disables a check. [Work only in TS mode]", false}
+    ,   {arg_check_report, "--check-report", "Write check issues to this file, one JSON object per line. Enables checks. [Work only in TS mode]", false}
+    ,   {arg_fail_on_check, "--fail-on-check", "Exit with code 2 if a check reports an error. Enables checks, not with --watch. [Work only in TS mode]", true}
+};
+
+//args[] ids sorted by name for the binary search in get_arg_id(), SHOULD BE KEPT SORTED (checked in debug builds)
+static const EArgID args_by_name[] = {
+        arg_check_report
+    ,   arg_checks
+    ,   arg_context
+    ,   arg_dst
+    ,   arg_fail_on_check
+    ,   arg_help
+    ,   arg_langid
+    ,   arg_location
+    ,   arg_mode
+    ,   arg_src
+    ,   arg_unfinished_only
+    ,   arg_watch
+    ,   arg_with_unfinished
+    ,   arg_with_vanished
 };
 
+static_assert(sizeof(args_by_name)/sizeof(EArgID) == sizeof(args)/sizeof(argument_info), "args_by_name[] does not match args[]");
+
 void show_help(int exit_code)
 {
     std::cout << "ts_tool v" VERSION " CODIJY 2018" << std::endl;
@@ -68,31 +98,72 @@ void show_help(int exit_code)
     exit(exit_code);
 }
 
+bool arg_name_less(EArgID id, const char *value)
+{
+    return strcmp(args[id].name, value) < 0;
+}
+
 EArgID get_arg_id(const char *value)
 {
-    EArgID id = arg_unknown;
-    std::any_of(args, args+sizeof(args)/sizeof(argument_info), [&id, value](const argument_info &nfo) -> bool
+    const EArgID *end = args_by_name + sizeof(args_by_name)/sizeof(EArgID);
+    const EArgID *it = std::lower_bound(args_by_name, end, value, arg_name_less);
+
+    return (end != it && 0 == strcmp(args[*it].name, value)) ? *it : arg_unknown;
+}
+
+//Startup latency probe for bench/startup_bench: TS_TOOL_BENCH_T0 holds the steady clock (ns) at which
+//the parent started this process, the time until the input is about to be read goes to stderr.
+void report_startup_latency()
+{
+    const char *t0 = getenv("TS_TOOL_BENCH_T0");
+    if(!t0) {
+        return;
+    }
+
+    const long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    std::cerr << "startup_us=" << (now - atoll(t0)) / 1000 << std::endl;
+}
+
+int report_checks(const translation_checks &checker, const QString &report_file, bool fail_on_check)
+{
+    std::for_each(checker.issues().begin(), checker.issues().end(), [](const translation_checks::issue &is)
         {
-            if(0 == strcmp(nfo.name, value)) {
-                id = nfo.id;
+            std::cerr << translation_checks::severity_name(is.severity) << ": " << translation_checks::check_name(is.check) << ": " << is.message;
+            if(!is.detail.isEmpty()) {
+                std::cerr << " " << is.detail.toUtf8().constData();
             }
-
-            return arg_unknown != id;
+            std::cerr << " <source>: " << is.source.toUtf8().constData() << " <translation>: " << is.translation.toUtf8().constData() << std::endl;
         }
     );
 
-    return id;
-}
+    std::cerr << "Checks: " << checker.count(translation_checks::sev_Error) << " error(s), " << checker.count(translation_checks::sev_Warning) << " warning(s)" << std::endl;
+
+    if(!report_file.isEmpty())
+    {
+        QFile report(report_file);
+        if(!report.open(QIODevice::WriteOnly|QIODevice::Text) || !checker.write_report(report)) {
+            std::cout << "Cant write check report: " << report_file.toUtf8().constData() << std::endl;
+            return -1;
+        }
+    }
 
+    return (fail_on_check && checker.count(translation_checks::sev_Error)) ? 2 : 0;
+}
 
 int main(int argc, char *argv[])
 {
-    QCoreApplication app(argc, argv);
-    QCoreApplication::setApplicationName("td_tool");
-    QCoreApplication::setApplicationVersion(VERSION);
+    //no QCoreApplication here: the conversion does not need it, only --watch (event loop) creates one
+    assert(std::is_sorted(args_by_name, args_by_name + sizeof(args_by_name)/sizeof(EArgID), [](EArgID l, EArgID r){ return strcmp(args[l].name, args[r].name) < 0; }));
+
+    QStringList srcs, dsts;
+    QString mode;
+    ts_core::extract_options extract_opt;
+    ts_core::merge_options merge_opt;
+    extract_opt.log = merge_opt.log = &std::cerr;
+    bool watch = false;
 
-    QString src, dst, mode, langid;
-    bool with_unfinished = false, with_vanished = false, unfinished_only = false;
+    QString checks_spec, check_report;
+    bool checks = false, fail_on_check = false;
 
     if(1 == argc) {
         show_help(0);
@@ -105,16 +176,22 @@ int main(int argc, char *argv[])
         switch(argId)
         {
         case arg_unknown: show_help(-1); break;
-        case arg_src: value = &src; break;
-        case arg_dst: value = &dst; break;
+        case arg_src: srcs.append(QString()); value = &srcs.last(); break;
+        case arg_dst: dsts.append(QString()); value = &dsts.last(); break;
         case arg_mode: value = &mode; break;
-        case arg_langid: value = &langid; break;
-        case arg_with_unfinished: with_unfinished = true; break;
-        case arg_with_vanished: with_vanished = true; break;
-        case arg_unfinished_only: unfinished_only = true; break;
+        case arg_langid: value = &merge_opt.langid; break;
+        case arg_with_unfinished: extract_opt.with_unfinished = true; break;
+        case arg_with_vanished: extract_opt.with_vanished = true; break;
+        case arg_unfinished_only: extract_opt.unfinished_only = true; break;
+        case arg_watch: watch = true; break;
+        case arg_context: value = &extract_opt.context_filter; break;
+        case arg_location: value = &extract_opt.location_filter; break;
+        case arg_checks: value = &checks_spec; checks = true; break;
+        case arg_check_report: value = &check_report; checks = true; break;
+        case arg_fail_on_check: fail_on_check = checks = true; break;
         }
 
-        if(value) {
+        if(value && n + 1 < argc) {
             *value = argv[++n];
         }
 
@@ -122,248 +199,87 @@ int main(int argc, char *argv[])
     }
 
 
-    if(src.isEmpty() || dst.isEmpty() || mode.isEmpty()) {
+    if(srcs.isEmpty() || dsts.isEmpty() || mode.isEmpty() || srcs.contains(QString()) || dsts.contains(QString())) {
         std::cout << "You may use at least first 3 args" << std::endl;
         show_help(-1);
     }
 
-    if("TXT" == mode)
-    {
-        toTXT(src, dst, with_unfinished, with_vanished, unfinished_only);
-    }
-    else if("TS" == mode)
-    {
-        toTS(src, dst, langid);
-    }
-    else
-    {
-        std::cout << "Invalid mode" << std::endl;
+    if(checks && "TS" != mode) {
+        std::cout << "--checks, --check-report and --fail-on-check work only in TS mode" << std::endl;
         show_help(-1);
     }
 
-    return 0;
-}
-
-base_node::base_node_ptr parse_ts_file(const QString &inputFile)
-{
-    QFile iFile(inputFile);
-    iFile.open(QIODevice::ReadOnly);
-
-    QXmlStreamReader xmlReader(&iFile);
-
-    base_node::base_node_ptr root, current;
-    QString text;
+    if(watch && fail_on_check) {
+        std::cout << "--fail-on-check has no exit code to set in --watch mode, checks are reported after every refresh" << std::endl;
+        show_help(-1);
+    }
 
-    enum EStates {
-			st_Unstate = 0
-        ,	st_WaitForStartElement = 0x01
-        ,   st_WaitForText = 0x02
-        ,   st_WaitForEndElement = 0x04
-    };
+    if(srcs.size() != dsts.size() || (!watch && 1 != srcs.size())) {
+        std::cout << "Every --src needs its own --dst, several pairs only with --watch" << std::endl;
+        show_help(-1);
+    }
 
-    int states = st_WaitForStartElement;
+    const QString src = srcs.first(), dst = dsts.first();
 
-    while(!xmlReader.atEnd())
+    translation_checks checker;
+    if(checks)
     {
-        QXmlStreamReader::TokenType tt = xmlReader.readNext();
-        switch(tt)
-        {
-        case QXmlStreamReader::StartDocument:
-            {
-                root = std::make_shared<document_node>();
-                current = root;
-            } break;
-        case QXmlStreamReader::DTD:
-            {
-                current->add_child(std::make_shared<DTD_node>("<!DOCTYPE TS>"));
-            } break;
-        case QXmlStreamReader::StartElement:
-            {
-                assert(states & st_WaitForStartElement);
-
-                QString name = xmlReader.name().toString();
-                QXmlStreamAttributes attrs = xmlReader.attributes();
-
-                if("message" == name) {
-					current = current->add_child(std::make_shared<element_node>(element_node::ent_message, name, attrs));
-                } else if("source" == name) {
-					current = current->add_child(std::make_shared<element_node>(element_node::ent_source, name, attrs));
-                } else if("translation" == name) {
-					current = current->add_child(std::make_shared<element_node>(element_node::ent_translation, name, attrs));
-                } else if("TS" == name) {
-					current = current->add_child(std::make_shared<TS_node>(name, attrs));	
-				} else {
-					current = current->add_child(std::make_shared<element_node>(element_node::ent_element, name, attrs));
-				}
-
-                states = st_WaitForText|st_WaitForStartElement|st_WaitForEndElement;
-            } break;
-        case QXmlStreamReader::Characters:
-            {
-                if(states & st_WaitForText) 
-                {
-                    text = xmlReader.text().toString();
-                    states = st_WaitForEndElement|st_WaitForStartElement;
-                }
-            } break;
-        case QXmlStreamReader::EndElement:
-            {
-                assert(states & st_WaitForEndElement);
-                assert(current->kind() & base_node::nt_Element);
-                ((element_node*)current.get())->set_text(text);
-                text.clear();
-                states = st_WaitForStartElement|st_WaitForEndElement;
-                current = current->parent();
-            } break;
+        if(!checks_spec.isEmpty() && !checker.set_severities(checks_spec)) {
+            std::cout << "Invalid --checks: " << checks_spec.toUtf8().constData() << std::endl;
+            show_help(-1);
         }
-    }
 
-    return root;
-}
-
-bool parse_txt_file(const QString &inputFile, visitors::map_QStringQString &strings)
-{
-    QFile iFile(inputFile);
-    iFile.open(QFile::ReadOnly|QFile::Text);
-    QTextStream txts(&iFile);
-    txts.setCodec("UTF-8");
-    
-    const QString rgxp("^(?<id>\\[\\[\\[[A-F0-9]{8}\\]\\]\\])\\s*[\\\",“,”](?<text>.*)[\\\",“,”]$");
-    QRegularExpression rxp(rgxp);
-
-    unsigned int line_counter = 0;
+        merge_opt.checks = &checker;
+    }
 
-    while(!txts.atEnd())
+    if(watch && ("TXT" == mode || "TS" == mode))
     {
-        QString str = txts.readLine();
-        QRegularExpressionMatch rm = rxp.match(str);
+        QCoreApplication app(argc, argv);
+        QCoreApplication::setApplicationName("td_tool");
+        QCoreApplication::setApplicationVersion(VERSION);
 
-        QString id		= rm.captured("id");
-        QString text	= rm.captured("text");
+        ts_watcher watcher("TXT" == mode ? ts_watcher::wm_TXT : ts_watcher::wm_TS, srcs, dsts, extract_opt, merge_opt);
 
-        if(id.isEmpty() || text.isEmpty())
+        //each refresh reports (and --check-report rewrites) the issues of its own merges
+        if(merge_opt.checks)
         {
-            std::cout << "Error in line: " << line_counter << " , file: " << inputFile.toUtf8().constData() << " , source line: " << str.toUtf8().constData() << std::endl;
-            return false;
+            watcher.on_merged([&checker, &check_report]()
+            {
+                report_checks(checker, check_report, false);
+                checker.clear();
+            });
         }
 
-        strings.insert(visitors::map_QStringQString::value_type(id, text));
-        line_counter++;
-    }	
-
-    return true;
-}
-
-void toTXT(const QString &inputFile, const QString &outputDir, bool with_unfinished, bool with_vanished, bool unfinished_only)
-{
-    using namespace visitors;
-
-    QFileInfo fiI(inputFile);
-    if(!fiI.exists()) {
-        std::cout << "Input file not exist!" << std::endl;
-        show_help(-1);
+        return watcher.exec();
     }
 
-    QFileInfo fiO(outputDir);
-    if(!fiO.exists()) {
-        QDir().mkdir(outputDir);
-    }
+    report_startup_latency();
 
-    QString outputXmlFileName = QDir(outputDir).path() + "/" + fiI.fileName();
-    QString outputTextFile = QDir(outputDir).path() + "/" + fiI.baseName() + ".txt";
-    
-    unsigned int files_in_out_dir = QDir(outputDir).entryInfoList(QDir::NoDotAndDotDot|QDir::AllEntries).count();
+    ts_core::EResult res = ts_core::res_Ok;
 
-    if( !fiO.exists() 
-        || 2 < files_in_out_dir
-        || (2 == files_in_out_dir && !QFileInfo(outputXmlFileName).exists() && !QFileInfo(outputTextFile).exists()) )
+    if("TXT" == mode)
     {
-        std::cout << "Cant create output directory OR directory is not empty!" << std::endl;
-        show_help(-1);
+        res = ts_core::extract_files(src, dst, extract_opt);
     }
-    
-    QFile oFile(outputXmlFileName);
-    oFile.open(QIODevice::WriteOnly);
-    
-    //pares ts file
-    base_node::base_node_ptr root = parse_ts_file(inputFile);
-
-    //replace strings
-    map_hashQString strings;
-    string_extractor_replacer ser(strings, with_unfinished, with_vanished, unfinished_only);
-    root->visit(ser);
-    
-    //write text file
-    QFile sFile(outputTextFile);
-    sFile.open(QIODevice::WriteOnly|QIODevice::Text);
-    QTextStream txts(&sFile);
-    txts.setCodec("UTF-8");
-        
-    std::for_each(strings.begin(), strings.end(), [&txts](const map_hashQString::value_type &vt){ txts << vt.second << "\n"; });
-
-    //write modified ts file
-    QXmlStreamWriter xmlWriter(&oFile);
-    xmlWriter.setAutoFormatting(true);
-
-    document_dump ddv(xmlWriter);
-    root->visit(ddv);
-}
-
-void toTS(const QString &inputDir, const QString &outputFile, const QString &langid)
-{
-    using namespace visitors;
-
-    QFileInfo fiI(inputDir);
-    if(!fiI.exists()) {
-        std::cout << "Input directory not exist!" << std::endl;
-        show_help(-1);
-    }
-
-    const QFileInfoList &fil = QDir(inputDir).entryInfoList(QDir::NoDotAndDotDot|QDir::AllEntries);
-    unsigned int files_in_input_dir = fil.count();
-
-    QString tsFile, txtFile;
-
-    if(2 == files_in_input_dir)
+    else if("TS" == mode)
     {
-        QFileInfo if0(QDir(inputDir).path() + "/" + fil[0].baseName() + ".ts");
-        QFileInfo if1(QDir(inputDir).path() + "/" + fil[0].baseName() + ".txt");
-
-        if(if0.isFile() && if1.isFile())
-        {
-            tsFile = if0.filePath();
-            txtFile = if1.filePath();
-        }
+        res = ts_core::merge_files(src, dst, merge_opt);
     }
-
-    if(2 < files_in_input_dir || 0 == files_in_input_dir || tsFile.isEmpty() || txtFile.isEmpty())
+    else
     {
-        std::cout << "Input directory should contain only txt and ts file with same name!" << std::endl;
+        std::cout << "Invalid mode" << std::endl;
         show_help(-1);
     }
 
-    //pares ts file
-    base_node::base_node_ptr root = parse_ts_file(tsFile);
-
-    //parse txt file
-    map_QStringQString strings;
-    if(!parse_txt_file(txtFile, strings)) {
-        std::cout << "Parsing error: " << txtFile.toUtf8().constData() << " !" << std::endl;
+    if(ts_core::res_Ok != res) {
+        std::cout << ts_core::result_text(res) << std::endl;
         show_help(-1);
     }
 
-    //replace strings
-    back_string_replacer bsr(strings, langid);
-    root->visit(bsr);
-
-    //dump to file
-    QFile oFile(outputFile);
-    oFile.open(QIODevice::WriteOnly);
-
-    QXmlStreamWriter xmlWriter(&oFile);
-    xmlWriter.setAutoFormatting(true);
-    xmlWriter.setCodec("UTF-8");
+    if("TS" == mode && merge_opt.checks)
+    {
+        return report_checks(checker, check_report, fail_on_check);
+    }
 
-    document_dump ddv(xmlWriter);
-    root->visit(ddv);
+    return 0;
 }
@@ -0,0 +1,197 @@
+﻿#include <iostream>
+#include <algorithm>
+
+//core
+#include "ts_core.h"
+
+//Qt
+#include <QBuffer>
+#include <QFile>
+#include <QTextCodec>
+#include <QXmlStreamWriter>
+
+//...............................................................................................................
+// filter_roundtrip - parse_ts() with a filter (rejected messages kept as raw input text) must extract exactly
+// what parsing every message and filtering in string_extractor_replacer extracts: same .txt, and a .ts whose
+// rejected messages equal the ones of the unfiltered output.
+// Runs on a generated catalog (several reader chunks, UTF-8 and ISO-8859-1) and on the .ts files given.
+// Inputs are first written back once by ts_core, so verbatim and rewritten text can be compared byte by byte.
+//
+// usage: filter_roundtrip [file.ts ...], exit code 0 when every output matches
+//...............................................................................................................
+
+QByteArray generate_catalog(bool latin1_only)
+{
+    static const char * const types[] = { nullptr, "unfinished", "vanished", "obsolete", nullptr };
+    const QString extra = latin1_only ? QString::fromUtf8(" \xC3\xA9\xC3\xBC") : QString::fromUtf8(" \xC3\xA9\xC3\xBC \xE6\x97\xA5\xE6\x9C\xAC");
+
+    QByteArray ts;
+    QBuffer buffer(&ts);
+    buffer.open(QIODevice::WriteOnly);
+
+    QXmlStreamWriter writer(&buffer);
+    writer.setAutoFormatting(true);
+    writer.writeStartDocument();
+    writer.writeDTD("<!DOCTYPE TS>");
+    writer.writeStartElement("TS");
+    writer.writeAttribute("version", "2.1");
+    writer.writeAttribute("language", "de_DE");
+
+    for(int c = 0; c < 40; ++c)
+    {
+        writer.writeStartElement("context");
+        writer.writeTextElement("name", QString("Context%1").arg(c));
+
+        for(int m = 0; m < 60; ++m)
+        {
+            const int n = c * 60 + m;
+
+            writer.writeStartElement("message");
+
+            writer.writeStartElement("location");
+            writer.writeAttribute("filename", 0 == n % 3 ? QString("../src/dialogs/dialog%1.cpp").arg(c) : QString("../src/main%1.cpp").arg(c));
+            writer.writeAttribute("line", QString::number(n));
+            writer.writeEndElement();
+
+            if(0 == n % 7)
+            {
+                writer.writeStartElement("location");
+                writer.writeAttribute("filename", "../src/dialogs/shared.cpp");
+                writer.writeAttribute("line", QString::number(n));
+                writer.writeEndElement();
+            }
+
+            writer.writeTextElement("source", QString("Text %1 & <b>\"%2\"</b>%3").arg(n).arg(0 == n % 11 ? "multi\nline" : "one").arg(extra));
+
+            writer.writeStartElement("translation");
+            if(const char *type = types[n % 5]) {
+                writer.writeAttribute("type", type);
+            }
+            if(0 != n % 4) {
+                writer.writeCharacters(QString("Übersetzung %1%2").arg(n).arg(extra));
+            }
+            writer.writeEndElement();
+
+            writer.writeEndElement();
+        }
+
+        writer.writeEndElement();
+    }
+
+    writer.writeEndElement();
+    writer.writeEndDocument();
+    return ts;
+}
+
+//the input as ts_core writes it, unchanged messages then look the same whether copied or rewritten
+bool rewrite(const QByteArray &ts, QByteArray &out)
+{
+    QBuffer input;
+    input.setData(ts);
+    input.open(QIODevice::ReadOnly);
+
+    base_node::base_node_ptr root;
+    if(ts_core::res_Ok != ts_core::parse_ts(input, root)) {
+        return false;
+    }
+
+    QBuffer output(&out);
+    output.open(QIODevice::WriteOnly);
+    return ts_core::res_Ok == ts_core::merge_tree(root, visitors::map_QStringQString(), output, ts_core::merge_options());
+}
+
+bool extract(const QByteArray &ts, bool pushdown, const ts_core::extract_options &opt, QByteArray &ts_out, QByteArray &txt_out)
+{
+    QBuffer input;
+    input.setData(ts);
+    input.open(QIODevice::ReadOnly);
+
+    const message_filter filter(opt.with_unfinished, opt.with_vanished, opt.unfinished_only, opt.context_filter, opt.location_filter);
+    base_node::base_node_ptr root;
+    if(ts_core::res_Ok != ts_core::parse_ts(input, root, opt.alloc, pushdown ? &filter : nullptr)) {
+        return false;
+    }
+
+    QBuffer tsOutput(&ts_out), txtOutput(&txt_out);
+    tsOutput.open(QIODevice::WriteOnly);
+    txtOutput.open(QIODevice::WriteOnly);
+    return ts_core::res_Ok == ts_core::extract_tree(root, tsOutput, txtOutput, opt);
+}
+
+bool check(const QString &name, const QByteArray &ts)
+{
+    struct filter_case
+    {
+        const char *name;
+        bool with_unfinished, with_vanished, unfinished_only;
+        const char *context, *location;
+    };
+
+    static const filter_case cases[] = {
+            {"defaults", false, false, false, "", ""}
+        ,   {"--unfinished-only", false, false, true, "", ""}
+        ,   {"--context Context1*", true, true, false, "Context1*", ""}
+        ,   {"--context Context2 --unfinished-only", false, false, true, "Context2", ""}
+        ,   {"--location */dialogs/*", true, false, false, "", "*/dialogs/*"}
+    };
+
+    return std::all_of(cases, cases + sizeof(cases)/sizeof(cases[0]), [&name, &ts](const filter_case &fc) -> bool
+    {
+        ts_core::extract_options opt;
+        opt.with_unfinished = fc.with_unfinished;
+        opt.with_vanished = fc.with_vanished;
+        opt.unfinished_only = fc.unfinished_only;
+        opt.context_filter = fc.context;
+        opt.location_filter = fc.location;
+
+        QByteArray ts1, txt1, ts2, txt2;
+        const bool ok = extract(ts, true, opt, ts1, txt1) && extract(ts, false, opt, ts2, txt2);
+        const bool same = ok && ts1 == ts2 && txt1 == txt2;
+
+        std::cout << (same ? "ok    " : "FAIL  ") << name.toUtf8().constData() << " " << fc.name;
+        if(!ok) {
+            std::cout << " (extract failed)";
+        } else if(!same) {
+            std::cout << " (.ts " << (ts1 == ts2 ? "equal" : "differs") << ", .txt " << (txt1 == txt2 ? "equal" : "differs") << ")";
+        }
+        std::cout << std::endl;
+
+        return same;
+    });
+}
+
+int main(int argc, char *argv[])
+{
+    bool passed = true;
+
+    QByteArray utf8;
+    if(!rewrite(generate_catalog(false), utf8)) {
+        std::cout << "Cant rewrite the generated catalog" << std::endl;
+        return -1;
+    }
+    passed = check("generated UTF-8", utf8) && passed;
+
+    //same text declared and encoded as ISO-8859-1, outputs are UTF-8 in both cases
+    QByteArray latin1;
+    if(!rewrite(generate_catalog(true), latin1)) {
+        std::cout << "Cant rewrite the generated catalog" << std::endl;
+        return -1;
+    }
+    latin1 = QTextCodec::codecForName("ISO-8859-1")->fromUnicode(QString::fromUtf8(latin1).replace("encoding=\"UTF-8\"", "encoding=\"ISO-8859-1\""));
+    passed = check("generated ISO-8859-1", latin1) && passed;
+
+    for(int n = 1; n < argc; ++n)
+    {
+        QFile file(QString::fromLocal8Bit(argv[n]));
+        QByteArray ts;
+
+        if(!file.open(QIODevice::ReadOnly) || !rewrite(file.readAll(), ts)) {
+            std::cout << "Cant read " << argv[n] << std::endl;
+            return -1;
+        }
+
+        passed = check(file.fileName(), ts) && passed;
+    }
+
+    return passed ? 0 : 1;
+}
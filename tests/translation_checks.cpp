@@ -0,0 +1,140 @@
+﻿#include <iostream>
+#include <algorithm>
+
+//core
+#include "ts_checks.h"
+
+//Qt
+#include <QString>
+
+//...............................................................................................................
+// translation_checks - the scanner rules of translation_checks::check() on source/translation pairs:
+// placeholders (%1..%99, %L1, %n, %Ln), accelerators (&&, entities, "& "), rich text tags (void, self-closing,
+// unbalanced sources, nesting deeper than the scanner tracks) and the configurable severities.
+//
+// usage: translation_checks, exit code 0 when every case gives the expected issues
+//...............................................................................................................
+
+typedef translation_checks tc;
+
+struct expected_issue
+{
+    tc::ECheck check;
+    tc::ESeverity severity;
+    const char *detail;
+};
+
+struct check_case
+{
+    const char *name;
+    QString source, translation;
+    int issues;                 //expected count, up to two are compared in order
+    expected_issue expected[2];
+};
+
+static const expected_issue none = { tc::chk_Count, tc::sev_Off, "" };
+
+QString nested_bold(int depth, const char *text)
+{
+    return QString("<b>").repeated(depth) + text + QString("</b>").repeated(depth);
+}
+
+bool run(const check_case &cc, translation_checks &checker)
+{
+    checker.clear();
+    checker.check("[[[00000000]]]", cc.source, cc.translation);
+
+    bool ok = int(checker.issues().size()) == cc.issues;
+    for(int n = 0; ok && n < cc.issues && n < 2; ++n)
+    {
+        const translation_checks::issue &is = checker.issues()[n];
+        ok = cc.expected[n].check == is.check && cc.expected[n].severity == is.severity && QString(cc.expected[n].detail) == is.detail;
+    }
+
+    std::cout << (ok ? "ok    " : "FAIL  ") << cc.name;
+    if(!ok)
+    {
+        std::cout << " (" << checker.issues().size() << " issue(s):";
+        std::for_each(checker.issues().begin(), checker.issues().end(), [](const translation_checks::issue &is)
+        {
+            std::cout << " [" << translation_checks::check_name(is.check) << " " << translation_checks::severity_name(is.severity)
+                      << " " << is.message << " " << is.detail.toUtf8().constData() << "]";
+        });
+        std::cout << ")";
+    }
+    std::cout << std::endl;
+
+    return ok;
+}
+
+int main()
+{
+    const expected_issue missing_2 = { tc::chk_Placeholders, tc::sev_Error, "%2" };
+    const expected_issue arg_1 = { tc::chk_Placeholders, tc::sev_Error, "%1" };
+    const expected_issue arg_10 = { tc::chk_Placeholders, tc::sev_Error, "%10" };
+    const expected_issue plural = { tc::chk_Placeholders, tc::sev_Error, "%n" };
+    const expected_issue accel = { tc::chk_Accelerators, tc::sev_Warning, "" };
+    const expected_issue markup = { tc::chk_Markup, tc::sev_Warning, "" };
+
+    const check_case cases[] = {
+            {"same placeholders", "Open %1", "Oeffnen %1", 0, {none, none}}
+        ,   {"placeholder missing", "%1 of %2", "%1 von", 1, {missing_2, none}}
+        ,   {"placeholder not in source", "%1", "%1 %2", 1, {missing_2, none}}
+        ,   {"placeholder order does not matter", "%1 of %2", "%2: %1", 0, {none, none}}
+        ,   {"%L1 is %1", "%L1 files", "%1 Dateien", 0, {none, none}}
+        ,   {"%Ln is %n", "%n file(s)", "%Ln Datei(en)", 0, {none, none}}
+        ,   {"plural missing", "%n files", "Dateien", 1, {plural, none}}
+        ,   {"%10 is one placeholder", "%10", "%10", 0, {none, none}}
+        ,   {"%10 is not %1 and 0", "%1", "%10", 2, {arg_1, arg_10}}
+        ,   {"%0 and %% are text", "100% and %0", "100 % und", 0, {none, none}}
+        ,   {"same accelerator", "&Open", "Oe&ffnen", 0, {none, none}}
+        ,   {"accelerator missing", "&Open", "Oeffnen", 1, {accel, none}}
+        ,   {"accelerator not in source", "Open", "&Oeffnen", 1, {accel, none}}
+        ,   {"more than one accelerator", "&Open", "&Oef&fnen", 1, {accel, none}}
+        ,   {"&& is an ampersand", "Save && Close", "Speichern &&Schliessen", 0, {none, none}}
+        ,   {"& followed by space is text", "Fish & Chips", "Fisch & Pommes", 0, {none, none}}
+        ,   {"& followed by space is not an accelerator", "Fish & Chips", "&Fisch", 1, {accel, none}}
+        ,   {"entities are not accelerators", "Tom &amp; Jerry &#123;", "&lt;Tom &amp; Jerry", 0, {none, none}}
+        ,   {"entity next to an accelerator", "&lt;&Open", "&lt;Oeffnen", 1, {accel, none}}
+        ,   {"same tags", "<b>Bold</b> <i>it</i>", "<i>es</i> <b>Fett</b>", 0, {none, none}}
+        ,   {"tag names ignore case", "<b>Bold</b>", "<B>Fett</b>", 0, {none, none}}
+        ,   {"tags differ", "<b>Bold</b>", "<i>Fett</i>", 1, {markup, none}}
+        ,   {"unbalanced translation", "<b>Bold</b>", "<b>Fett", 1, {markup, none}}
+        ,   {"void and self-closing tags are not counted", "<p>a<br>b<img src=\"x.png\"/></p>", "<p>a<br/>b</p>", 0, {none, none}}
+        ,   {"<none> is plain text", "<none>", "<keine>", 0, {none, none}}
+        ,   {"<none> translated as is", "<none>", "<none>", 0, {none, none}}
+        ,   {"unbalanced source is not compared", "<Untitled> <b>x</b>", "<Unbenannt>", 0, {none, none}}
+        ,   {"64 nested tags are tracked", nested_bold(64, "x"), "x", 1, {markup, none}}
+        ,   {"deeper nesting is treated as unbalanced", nested_bold(65, "x"), "x", 0, {none, none}}
+    };
+
+    bool passed = true;
+    translation_checks checker;
+
+    std::for_each(cases, cases + sizeof(cases)/sizeof(cases[0]), [&passed, &checker](const check_case &cc)
+    {
+        passed = run(cc, checker) && passed;
+    });
+
+    //counts sum up over calls, clear() resets them
+    checker.clear();
+    checker.check("1", "%1 &Open <b>x</b>", "Oeffnen x");
+    checker.check("2", "%1", "%1");
+    const bool counted = 1 == checker.count(tc::sev_Error) && 2 == checker.count(tc::sev_Warning);
+    checker.clear();
+    const bool cleared = checker.issues().empty() && 0 == checker.count(tc::sev_Error) && 0 == checker.count(tc::sev_Warning);
+    std::cout << (counted && cleared ? "ok    " : "FAIL  ") << "counts and clear()" << std::endl;
+    passed = counted && cleared && passed;
+
+    //severities from --checks
+    translation_checks configured;
+    const bool parsed = configured.set_severities("placeholders=off, markup=error") && !configured.set_severities("spelling=error")
+        && !configured.set_severities("markup=fatal");
+    configured.check("1", "%1 <b>x</b>", "<i>x</i>");
+    const bool applied = parsed && 1 == configured.issues().size() && tc::chk_Markup == configured.issues()[0].check
+        && tc::sev_Error == configured.issues()[0].severity && tc::sev_Warning == configured.severity(tc::chk_Accelerators);
+    std::cout << (applied ? "ok    " : "FAIL  ") << "set_severities()" << std::endl;
+    passed = applied && passed;
+
+    return passed ? 0 : 1;
+}
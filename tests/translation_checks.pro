@@ -0,0 +1,25 @@
+TARGET = translation_checks
+CONFIG += core xml console c++11
+TEMPLATE = app
+
+#-------------------------------------------------------------------------------------
+GENF_ROOT   = ../_output
+BIN_OUTPUT  = $${GENF_ROOT}/_bin
+#-------------------------------------------------------------------------------------
+
+CONFIG(release, debug|release) {
+    BUILD_TYPE = release
+} else {
+    BUILD_TYPE = debug
+}
+
+DESTDIR     = $${BIN_OUTPUT}/$${BUILD_TYPE}
+OBJECTS_DIR = $${GENF_ROOT}/$${TARGET}/$${BUILD_TYPE}/_build
+MOC_DIR     = $${GENF_ROOT}/$${TARGET}/$${BUILD_TYPE}/_moc
+
+##-------------------------------------------------------------------------------------
+
+include(../ts_core.pri)
+
+SOURCES += \
+    ./translation_checks.cpp
@@ -0,0 +1,69 @@
+#ifndef __ts_alloc_h__
+#define __ts_alloc_h__
+
+//std
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+//...............................................................................................................
+// Caller provided memory for tree nodes, shared by the parser (ts_core) and base_node::clone (ts_model).
+//...............................................................................................................
+
+namespace ts_core
+{
+    // Memory for the tree nodes. Must outlive every tree allocated through it.
+    struct allocator
+    {
+        virtual ~allocator() {}
+        virtual void * allocate(std::size_t size) = 0;
+        virtual void deallocate(void *ptr, std::size_t size) = 0;
+    };
+
+    //STL allocator over ts_core::allocator, used with std::allocate_shared for tree nodes
+    template<typename T>
+    struct node_allocator
+    {
+        typedef T value_type;
+
+        node_allocator(allocator *alloc) : m_alloc(alloc) {}
+        template<typename U> node_allocator(const node_allocator<U> &other) : m_alloc(other.m_alloc) {}
+
+        T * allocate(std::size_t n)
+        {
+            if(!m_alloc) {
+                return static_cast<T*>(::operator new(n * sizeof(T)));
+            }
+
+            void *ptr = m_alloc->allocate(n * sizeof(T));
+            if(!ptr) {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(ptr);
+        }
+
+        void deallocate(T *ptr, std::size_t n)
+        {
+            if(m_alloc) {
+                m_alloc->deallocate(ptr, n * sizeof(T));
+            } else {
+                ::operator delete(ptr);
+            }
+        }
+
+        template<typename U> bool operator == (const node_allocator<U> &other) const { return m_alloc == other.m_alloc; }
+        template<typename U> bool operator != (const node_allocator<U> &other) const { return m_alloc != other.m_alloc; }
+
+        allocator *m_alloc;
+    };
+
+    //nullptr alloc - default heap
+    template<typename T, typename... Args>
+    std::shared_ptr<T> make_node(allocator *alloc, Args&&... args)
+    {
+        return std::allocate_shared<T>(node_allocator<T>(alloc), std::forward<Args>(args)...);
+    }
+}
+
+#endif // __ts_alloc_h__
@@ -0,0 +1,331 @@
+﻿#include "ts_checks.h"
+
+//std
+#include <string.h>
+#include <algorithm>
+
+//Qt
+#include <QIODevice>
+#include <QStringList>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+namespace
+{
+    enum { max_args = 100, max_tag_depth = 64 };
+
+    //what one scan of a text collects, fixed size so nothing is allocated per message
+    struct text_profile
+    {
+        text_profile() : plurals(0), accelerators(0), tags(0), tags_signature(0), tags_balanced(true)
+        {
+            memset(args, 0, sizeof(args));
+        }
+
+        unsigned char args[max_args];   //occurrences of %1..%99 (saturated), %L1 counts as %1
+        unsigned int plurals;           //%n, %Ln
+        unsigned int accelerators;
+        unsigned int tags;              //opened rich text tags
+        unsigned int tags_signature;    //sum of opened tag name hashes, equal for the same set of tags
+        bool tags_balanced;
+    };
+
+    inline bool is_digit(ushort c) { return '0' <= c && c <= '9'; }
+    inline bool is_alpha(ushort c) { return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z'); }
+    inline ushort to_lower(ushort c) { return ('A' <= c && c <= 'Z') ? ushort(c - 'A' + 'a') : c; }
+
+    unsigned int tag_hash(const ushort *name, int size)
+    {
+        unsigned int h = 2166136261u;
+        for(int n = 0; n < size; ++n) {
+            h = (h ^ to_lower(name[n])) * 16777619u;
+        }
+        return h;
+    }
+
+    bool is_void_tag(const ushort *name, int size)
+    {
+        static const char * const void_tags[] = { "br", "hr", "img", "meta", "input", "col", "area", "base", "link", "param", "wbr" };
+
+        return std::any_of(void_tags, void_tags + sizeof(void_tags)/sizeof(void_tags[0]), [name, size](const char *tag) -> bool
+        {
+            int n = 0;
+            for(; n < size && tag[n] && to_lower(name[n]) == ushort(tag[n]); ++n) {}
+            return n == size && !tag[n];
+        });
+    }
+
+    //&& is an escaped ampersand, &name; / &#123; an entity of rich text, "& " plain text
+    bool is_accelerator(const ushort *p, const ushort *end)
+    {
+        const ushort *next = p + 1;
+        if(next == end || '&' == *next || ' ' == *next || '\t' == *next || '\n' == *next) {
+            return false;
+        }
+
+        if(is_alpha(*next) || '#' == *next)
+        {
+            const ushort *q = next + 1;
+            while(q != end && (is_alpha(*q) || is_digit(*q))) {
+                ++q;
+            }
+
+            if(q != end && ';' == *q) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //returns the position after the tag, or p + 1 when '<' does not start a tag
+    const ushort * scan_tag(const ushort *p, const ushort *end, text_profile &tp, unsigned int *stack, int &depth)
+    {
+        const ushort *q = p + 1;
+        const bool closing = q != end && '/' == *q;
+        if(closing) {
+            ++q;
+        }
+
+        const ushort *name = q;
+        if(q == end || !is_alpha(*q)) {
+            return p + 1;
+        }
+
+        while(q != end && (is_alpha(*q) || is_digit(*q))) {
+            ++q;
+        }
+
+        const int name_size = int(q - name);
+
+        while(q != end && '>' != *q) {
+            ++q;
+        }
+
+        if(q == end) {
+            return p + 1;
+        }
+
+        const bool self_closing = '/' == *(q - 1);
+        const unsigned int h = tag_hash(name, name_size);
+
+        if(closing)
+        {
+            if(0 == depth || stack[depth - 1] != h) {
+                tp.tags_balanced = false;
+            } else {
+                --depth;
+            }
+        }
+        else if(!self_closing && !is_void_tag(name, name_size))
+        {
+            if(max_tag_depth == depth) {
+                tp.tags_balanced = false;
+            } else {
+                stack[depth++] = h;
+            }
+
+            tp.tags++;
+            tp.tags_signature += h;
+        }
+
+        return q + 1;
+    }
+
+    void scan(const QString &text, text_profile &tp)
+    {
+        const ushort *p = text.utf16(), *end = p + text.size();
+
+        unsigned int stack[max_tag_depth];
+        int depth = 0;
+
+        while(p != end)
+        {
+            switch(*p)
+            {
+            case '%':
+                {
+                    const ushort *q = p + 1;
+                    if(q != end && 'L' == *q) {
+                        ++q;
+                    }
+
+                    if(q != end && 'n' == *q)
+                    {
+                        tp.plurals++;
+                        p = q + 1;
+                    }
+                    else if(q != end && is_digit(*q) && '0' != *q)
+                    {
+                        int arg = *q++ - '0';
+                        if(q != end && is_digit(*q)) {
+                            arg = arg * 10 + (*q++ - '0');
+                        }
+
+                        if(tp.args[arg] < 0xff) {
+                            tp.args[arg]++;
+                        }
+                        p = q;
+                    }
+                    else
+                    {
+                        ++p;
+                    }
+                } break;
+            case '&':
+                {
+                    if(is_accelerator(p, end)) {
+                        tp.accelerators++;
+                        ++p;
+                    } else {
+                        p += (p + 1 != end && '&' == p[1]) ? 2 : 1;
+                    }
+                } break;
+            case '<':
+                {
+                    p = scan_tag(p, end, tp, stack, depth);
+                } break;
+            default:
+                ++p;
+            }
+        }
+
+        if(depth) {
+            tp.tags_balanced = false;
+        }
+    }
+}
+
+//...............................................................................................................
+
+translation_checks::translation_checks()
+{
+    m_severity[chk_Placeholders] = sev_Error;
+    m_severity[chk_Accelerators] = sev_Warning;
+    m_severity[chk_Markup] = sev_Warning;
+
+    std::fill(m_counts, m_counts + sev_Count, 0u);
+}
+
+const char * translation_checks::check_name(ECheck check)
+{
+    switch(check)
+    {
+    case chk_Placeholders:  return "placeholders";
+    case chk_Accelerators:  return "accelerators";
+    case chk_Markup:        return "markup";
+    default:                return "";
+    }
+}
+
+const char * translation_checks::severity_name(ESeverity severity)
+{
+    switch(severity)
+    {
+    case sev_Off:       return "off";
+    case sev_Warning:   return "warning";
+    case sev_Error:     return "error";
+    default:            return "";
+    }
+}
+
+bool translation_checks::set_severities(const QString &spec)
+{
+    const QStringList items = spec.split(',', QString::SkipEmptyParts);
+
+    return std::all_of(items.begin(), items.end(), [this](const QString &item) -> bool
+    {
+        const QStringList kv = item.trimmed().split('=');
+        if(2 != kv.size()) {
+            return false;
+        }
+
+        int check = 0, severity = 0;
+        for(; check < chk_Count && kv[0].trimmed() != check_name(ECheck(check)); ++check) {}
+        for(; severity < sev_Count && kv[1].trimmed() != severity_name(ESeverity(severity)); ++severity) {}
+
+        if(chk_Count == check || sev_Count == severity) {
+            return false;
+        }
+
+        m_severity[check] = ESeverity(severity);
+        return true;
+    });
+}
+
+void translation_checks::clear()
+{
+    m_issues.clear();
+    std::fill(m_counts, m_counts + sev_Count, 0u);
+}
+
+void translation_checks::add(ECheck check, const char *message, const QString &detail, const QString &id, const QString &source, const QString &translation)
+{
+    issue is = { check, m_severity[check], message, detail, id, source, translation };
+    m_issues.push_back(is);
+    m_counts[is.severity]++;
+}
+
+void translation_checks::check(const QString &id, const QString &source, const QString &translation)
+{
+    if(sev_Off == m_severity[chk_Placeholders] && sev_Off == m_severity[chk_Accelerators] && sev_Off == m_severity[chk_Markup]) {
+        return;
+    }
+
+    text_profile src, tr;
+    scan(source, src);
+    scan(translation, tr);
+
+    if(sev_Off != m_severity[chk_Placeholders])
+    {
+        for(int arg = 1; arg < max_args; ++arg)
+        {
+            if(!src.args[arg] != !tr.args[arg]) {
+                add(chk_Placeholders, src.args[arg] ? "placeholder missing in translation" : "placeholder not in source"
+                    , QString("%%1").arg(arg), id, source, translation);
+            }
+        }
+
+        if(!src.plurals != !tr.plurals) {
+            add(chk_Placeholders, src.plurals ? "placeholder missing in translation" : "placeholder not in source", "%n", id, source, translation);
+        }
+    }
+
+    if(sev_Off != m_severity[chk_Accelerators])
+    {
+        if(!src.accelerators != !tr.accelerators) {
+            add(chk_Accelerators, src.accelerators ? "accelerator missing in translation" : "accelerator not in source", QString(), id, source, translation);
+        } else if(1 < tr.accelerators) {
+            add(chk_Accelerators, "more than one accelerator in translation", QString(), id, source, translation);
+        }
+    }
+
+    //a source with unbalanced tags is not rich text, e.g. tr("<none>") uses the brackets as plain text
+    if(sev_Off != m_severity[chk_Markup] && src.tags && src.tags_balanced)
+    {
+        if(!tr.tags_balanced) {
+            add(chk_Markup, "unbalanced rich text tags in translation", QString(), id, source, translation);
+        } else if(src.tags != tr.tags || src.tags_signature != tr.tags_signature) {
+            add(chk_Markup, "rich text tags differ from source", QString(), id, source, translation);
+        }
+    }
+}
+
+bool translation_checks::write_report(QIODevice &output) const
+{
+    return std::all_of(m_issues.begin(), m_issues.end(), [&output](const issue &is) -> bool
+    {
+        QJsonObject obj;
+        obj.insert("id", is.id);
+        obj.insert("check", QString::fromLatin1(check_name(is.check)));
+        obj.insert("severity", QString::fromLatin1(severity_name(is.severity)));
+        obj.insert("message", QString::fromLatin1(is.message));
+        obj.insert("detail", is.detail);
+        obj.insert("source", is.source);
+        obj.insert("translation", is.translation);
+
+        QByteArray line = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+        line.append('\n');
+        return line.size() == output.write(line);
+    });
+}
@@ -0,0 +1,64 @@
+#ifndef __ts_checks_h__
+#define __ts_checks_h__
+
+//Qt
+#include <QString>
+
+//std
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+    class QIODevice;
+QT_END_NAMESPACE
+
+//...............................................................................................................
+// translation_checks - consistency of a translation with its source, run by back_string_replacer while merging:
+//  placeholders    %1..%99, %L1, %n, %Ln present in both or in neither
+//  accelerators    & mnemonic (&& and &entity; excluded) in both or in neither, at most one in translation
+//  markup          if the rich text tags of the source are balanced, the translation has the same ones, balanced
+// Both texts are scanned once with fixed-size state, memory is only allocated for reported issues.
+//...............................................................................................................
+
+struct translation_checks
+{
+    enum ECheck { chk_Placeholders = 0, chk_Accelerators, chk_Markup, chk_Count };
+    enum ESeverity { sev_Off = 0, sev_Warning, sev_Error, sev_Count };
+
+    struct issue
+    {
+        ECheck check;
+        ESeverity severity;
+        const char *message;
+        QString detail;         //e.g. "%2", may be empty
+        QString id, source, translation;
+    };
+
+    translation_checks();   //placeholders: error, accelerators: warning, markup: warning
+
+    //"placeholders=error,accelerators=off,markup=warning", returns false on unknown names
+    bool set_severities(const QString &spec);
+    void set_severity(ECheck check, ESeverity severity) { m_severity[check] = severity; }
+    ESeverity severity(ECheck check) const { return m_severity[check]; }
+
+    void check(const QString &id, const QString &source, const QString &translation);
+
+    const std::vector<issue> & issues() const { return m_issues; }
+    void clear();   //issues and counts, severities are kept
+    unsigned int count(ESeverity severity) const { return m_counts[severity]; }
+
+    //one JSON object per line
+    bool write_report(QIODevice &output) const;
+
+    static const char * check_name(ECheck check);
+    static const char * severity_name(ESeverity severity);
+
+private:
+    void add(ECheck check, const char *message, const QString &detail, const QString &id, const QString &source, const QString &translation);
+
+private:
+    ESeverity m_severity[chk_Count];
+    std::vector<issue> m_issues;
+    unsigned int m_counts[sev_Count];
+};
+
+#endif // __ts_checks_h__
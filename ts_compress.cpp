@@ -0,0 +1,589 @@
+﻿#include "ts_compress.h"
+
+//std
+#include <assert.h>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//Qt
+#include <QFile>
+#include <QByteArray>
+
+#ifdef TS_WITH_GZIP
+#include <zlib.h>
+#endif
+
+#ifdef TS_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace ts_core
+{
+    namespace
+    {
+        enum { chunk_size = 64 * 1024, max_queued_chunks = 4 };
+
+        //.........................................................................................
+        // codecs
+
+        struct stream_decoder
+        {
+            virtual ~stream_decoder() {}
+
+            //consumes from [in, in_end), produces into [out, out_end), advances both; false on corrupt data
+            virtual bool decode(const char *&in, const char *in_end, char *&out, char *out_end, bool &finished) = 0;
+        };
+
+        struct stream_encoder
+        {
+            virtual ~stream_encoder() {}
+
+            //appends compressed data to out, finish terminates the stream
+            virtual bool encode(const char *in, std::size_t size, QByteArray &out) = 0;
+            virtual bool finish(QByteArray &out) = 0;
+        };
+
+#ifdef TS_WITH_GZIP
+        struct gzip_decoder : stream_decoder
+        {
+            gzip_decoder() : m_ok(false)
+            {
+                m_zs = z_stream();
+                m_ok = Z_OK == inflateInit2(&m_zs, 16 + MAX_WBITS);
+            }
+            ~gzip_decoder() { if(m_ok) inflateEnd(&m_zs); }
+
+            virtual bool decode(const char *&in, const char *in_end, char *&out, char *out_end, bool &finished)
+            {
+                if(!m_ok) {
+                    return false;
+                }
+
+                m_zs.next_in = (Bytef*)in;
+                m_zs.avail_in = uInt(in_end - in);
+                m_zs.next_out = (Bytef*)out;
+                m_zs.avail_out = uInt(out_end - out);
+
+                int ret = inflate(&m_zs, Z_NO_FLUSH);
+
+                in = (const char*)m_zs.next_in;
+                out = (char*)m_zs.next_out;
+                finished = Z_STREAM_END == ret;
+
+                return Z_OK == ret || Z_STREAM_END == ret || Z_BUF_ERROR == ret;
+            }
+
+        private:
+            z_stream m_zs;
+            bool m_ok;
+        };
+
+        struct gzip_encoder : stream_encoder
+        {
+            gzip_encoder() : m_ok(false)
+            {
+                m_zs = z_stream();
+                m_ok = Z_OK == deflateInit2(&m_zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+            }
+            ~gzip_encoder() { if(m_ok) deflateEnd(&m_zs); }
+
+            virtual bool encode(const char *in, std::size_t size, QByteArray &out) { return run(in, size, Z_NO_FLUSH, out); }
+            virtual bool finish(QByteArray &out) { return run(nullptr, 0, Z_FINISH, out); }
+
+        private:
+            bool run(const char *in, std::size_t size, int flush, QByteArray &out)
+            {
+                if(!m_ok) {
+                    return false;
+                }
+
+                m_zs.next_in = (Bytef*)in;
+                m_zs.avail_in = uInt(size);
+
+                int ret = Z_OK;
+                do
+                {
+                    char buffer[chunk_size];
+                    m_zs.next_out = (Bytef*)buffer;
+                    m_zs.avail_out = sizeof(buffer);
+
+                    ret = deflate(&m_zs, flush);
+                    if(Z_STREAM_ERROR == ret) {
+                        return false;
+                    }
+
+                    out.append(buffer, int(sizeof(buffer) - m_zs.avail_out));
+                }
+                while(0 == m_zs.avail_out || (Z_FINISH == flush && Z_STREAM_END != ret));
+
+                return true;
+            }
+
+            z_stream m_zs;
+            bool m_ok;
+        };
+#endif
+
+#ifdef TS_WITH_ZSTD
+        struct zstd_decoder : stream_decoder
+        {
+            zstd_decoder() : m_ds(ZSTD_createDStream()) { if(m_ds) ZSTD_initDStream(m_ds); }
+            ~zstd_decoder() { ZSTD_freeDStream(m_ds); }
+
+            virtual bool decode(const char *&in, const char *in_end, char *&out, char *out_end, bool &finished)
+            {
+                if(!m_ds) {
+                    return false;
+                }
+
+                ZSTD_inBuffer input = { in, std::size_t(in_end - in), 0 };
+                ZSTD_outBuffer output = { out, std::size_t(out_end - out), 0 };
+
+                std::size_t ret = ZSTD_decompressStream(m_ds, &output, &input);
+
+                in += input.pos;
+                out += output.pos;
+                finished = 0 == ret;
+
+                return !ZSTD_isError(ret);
+            }
+
+        private:
+            ZSTD_DStream *m_ds;
+        };
+
+        struct zstd_encoder : stream_encoder
+        {
+            zstd_encoder() : m_cs(ZSTD_createCStream()) { if(m_cs) ZSTD_initCStream(m_cs, 3); }
+            ~zstd_encoder() { ZSTD_freeCStream(m_cs); }
+
+            virtual bool encode(const char *in, std::size_t size, QByteArray &out)
+            {
+                if(!m_cs) {
+                    return false;
+                }
+
+                ZSTD_inBuffer input = { in, size, 0 };
+                while(input.pos < input.size)
+                {
+                    char buffer[chunk_size];
+                    ZSTD_outBuffer output = { buffer, sizeof(buffer), 0 };
+
+                    if(ZSTD_isError(ZSTD_compressStream(m_cs, &output, &input))) {
+                        return false;
+                    }
+
+                    out.append(buffer, int(output.pos));
+                }
+
+                return true;
+            }
+
+            virtual bool finish(QByteArray &out)
+            {
+                if(!m_cs) {
+                    return false;
+                }
+
+                std::size_t remaining = 0;
+                do
+                {
+                    char buffer[chunk_size];
+                    ZSTD_outBuffer output = { buffer, sizeof(buffer), 0 };
+
+                    remaining = ZSTD_endStream(m_cs, &output);
+                    if(ZSTD_isError(remaining)) {
+                        return false;
+                    }
+
+                    out.append(buffer, int(output.pos));
+                }
+                while(remaining);
+
+                return true;
+            }
+
+        private:
+            ZSTD_CStream *m_cs;
+        };
+#endif
+
+        std::unique_ptr<stream_decoder> make_decoder(ECompression cmp)
+        {
+            switch(cmp)
+            {
+#ifdef TS_WITH_GZIP
+            case cmp_Gzip: return std::unique_ptr<stream_decoder>(new gzip_decoder());
+#endif
+#ifdef TS_WITH_ZSTD
+            case cmp_Zstd: return std::unique_ptr<stream_decoder>(new zstd_decoder());
+#endif
+            default: return std::unique_ptr<stream_decoder>();
+            }
+        }
+
+        std::unique_ptr<stream_encoder> make_encoder(ECompression cmp)
+        {
+            switch(cmp)
+            {
+#ifdef TS_WITH_GZIP
+            case cmp_Gzip: return std::unique_ptr<stream_encoder>(new gzip_encoder());
+#endif
+#ifdef TS_WITH_ZSTD
+            case cmp_Zstd: return std::unique_ptr<stream_encoder>(new zstd_encoder());
+#endif
+            default: return std::unique_ptr<stream_encoder>();
+            }
+        }
+
+        ECompression compression_from_magic(const QByteArray &head)
+        {
+            if(2 <= head.size() && '\x1f' == head[0] && '\x8b' == head[1]) {
+                return cmp_Gzip;
+            }
+
+            if(4 <= head.size() && '\x28' == head[0] && '\xb5' == head[1] && '\x2f' == head[2] && '\xfd' == head[3]) {
+                return cmp_Zstd;
+            }
+
+            return cmp_None;
+        }
+
+        //.........................................................................................
+        // devices
+
+        //read-only, decompresses the file chunk by chunk into the caller's buffer
+        struct decompress_device : QIODevice
+        {
+            decompress_device(const QString &path, ECompression cmp)
+                : m_file(path), m_decoder(make_decoder(cmp)), m_in_pos(0), m_eof(false)
+            {}
+
+            bool open_device(QIODevice::OpenMode mode)
+            {
+                return m_decoder && m_file.open(QIODevice::ReadOnly) && open(mode|QIODevice::Unbuffered);
+            }
+
+            virtual bool isSequential() const { return true; }
+            virtual bool atEnd() const { return m_eof && 0 == QIODevice::bytesAvailable(); }
+
+        protected:
+            //blocks until some output is produced, 0 only at the end of the stream
+            virtual qint64 readData(char *data, qint64 maxSize)
+            {
+                char *out = data, *out_end = data + maxSize;
+
+                while(out == data && !m_eof)
+                {
+                    if(m_in_pos == m_in.size())
+                    {
+                        m_in = m_file.read(chunk_size);
+                        m_in_pos = 0;
+
+                        if(m_in.isEmpty())
+                        {
+                            //truncated stream
+                            setErrorString("Unexpected end of compressed data");
+                            return -1;
+                        }
+                    }
+
+                    const char *in = m_in.constData() + m_in_pos;
+                    bool finished = false;
+
+                    if(!m_decoder->decode(in, m_in.constData() + m_in.size(), out, out_end, finished))
+                    {
+                        setErrorString("Corrupt compressed data");
+                        return -1;
+                    }
+
+                    m_in_pos = int(in - m_in.constData());
+                    m_eof = finished;
+                }
+
+                return out - data;
+            }
+
+            virtual qint64 writeData(const char * /*data*/, qint64 /*size*/) { return -1; }
+
+        private:
+            QFile m_file;
+            std::unique_ptr<stream_decoder> m_decoder;
+            QByteArray m_in;
+            int m_in_pos;
+            bool m_eof;
+        };
+
+        //write-only, hands full chunks to a worker thread which compresses and writes them to the file
+        struct compress_device : QIODevice
+        {
+            compress_device(const QString &path, ECompression cmp)
+                : m_file(path), m_encoder(make_encoder(cmp)), m_closing(false), m_failed(false)
+            {}
+
+            ~compress_device() { close(); }
+
+            bool open_device(QIODevice::OpenMode mode)
+            {
+                if(!m_encoder || !m_file.open(QIODevice::WriteOnly) || !open(mode|QIODevice::Unbuffered)) {
+                    return false;
+                }
+
+                m_chunk.reserve(chunk_size);
+                m_worker = std::thread([this]() { work(); });
+                return true;
+            }
+
+            virtual bool isSequential() const { return true; }
+
+            virtual void close()
+            {
+                if(!isOpen()) {
+                    return;
+                }
+
+                push(m_chunk);
+                m_chunk.clear();
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_closing = true;
+                }
+                m_cv.notify_all();
+
+                if(m_worker.joinable()) {
+                    m_worker.join();
+                }
+
+                m_file.close();
+                QIODevice::close();
+            }
+
+            bool failed() const
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_failed;
+            }
+
+        protected:
+            virtual qint64 readData(char * /*data*/, qint64 /*maxSize*/) { return -1; }
+
+            virtual qint64 writeData(const char *data, qint64 size)
+            {
+                if(failed()) {
+                    return -1;
+                }
+
+                m_chunk.append(data, int(size));
+
+                if(chunk_size <= m_chunk.size())
+                {
+                    push(m_chunk);
+                    m_chunk.clear();
+                    m_chunk.reserve(chunk_size);
+                }
+
+                return size;
+            }
+
+        private:
+            //blocks while the queue is full, which bounds the memory
+            void push(const QByteArray &chunk)
+            {
+                if(chunk.isEmpty()) {
+                    return;
+                }
+
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_queue.size() < max_queued_chunks || m_failed; });
+                m_queue.push_back(chunk);
+                lock.unlock();
+                m_cv.notify_all();
+            }
+
+            void work()
+            {
+                QByteArray out;
+                bool ok = true;
+
+                for(;;)
+                {
+                    QByteArray chunk;
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_cv.wait(lock, [this]() { return !m_queue.empty() || m_closing; });
+
+                        if(m_queue.empty()) {
+                            break;
+                        }
+
+                        chunk = m_queue.front();
+                        m_queue.pop_front();
+                    }
+                    m_cv.notify_all();
+
+                    out.clear();
+                    ok = ok && m_encoder->encode(chunk.constData(), std::size_t(chunk.size()), out) && out.size() == m_file.write(out);
+                    if(!ok) {
+                        set_failed();
+                    }
+                }
+
+                out.clear();
+                if(!ok || !m_encoder->finish(out) || out.size() != m_file.write(out) || !m_file.flush()) {
+                    set_failed();
+                }
+            }
+
+            void set_failed()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_failed = true;
+                }
+                m_cv.notify_all();
+            }
+
+        private:
+            QFile m_file;                   //used by the worker only while it runs
+            std::unique_ptr<stream_encoder> m_encoder;
+            QByteArray m_chunk;
+
+            std::thread m_worker;
+            mutable std::mutex m_mutex;
+            std::condition_variable m_cv;
+            std::deque<QByteArray> m_queue;
+            bool m_closing, m_failed;
+        };
+    }
+
+    //...............................................................................................................
+
+    ECompression compression_from_name(const QString &path)
+    {
+        if(path.endsWith(".gz", Qt::CaseInsensitive)) {
+            return cmp_Gzip;
+        }
+
+        if(path.endsWith(".zst", Qt::CaseInsensitive)) {
+            return cmp_Zstd;
+        }
+
+        return cmp_None;
+    }
+
+    const char * compression_suffix(ECompression cmp)
+    {
+        switch(cmp)
+        {
+        case cmp_Gzip: return ".gz";
+        case cmp_Zstd: return ".zst";
+        default: return "";
+        }
+    }
+
+    bool compression_supported(ECompression cmp)
+    {
+        switch(cmp)
+        {
+        case cmp_None: return true;
+#ifdef TS_WITH_GZIP
+        case cmp_Gzip: return true;
+#endif
+#ifdef TS_WITH_ZSTD
+        case cmp_Zstd: return true;
+#endif
+        default: return false;
+        }
+    }
+
+    std::unique_ptr<QIODevice> open_input(const QString &path, QIODevice::OpenMode mode, EResult &res)
+    {
+        ECompression cmp = cmp_None;
+        {
+            QFile probe(path);
+            if(!probe.open(QIODevice::ReadOnly)) {
+                res = res_OpenError;
+                return std::unique_ptr<QIODevice>();
+            }
+            cmp = compression_from_magic(probe.peek(4));
+        }
+
+        if(!compression_supported(cmp)) {
+            res = res_UnsupportedCompression;
+            return std::unique_ptr<QIODevice>();
+        }
+
+        res = res_OpenError;
+
+        if(cmp_None == cmp)
+        {
+            std::unique_ptr<QIODevice> file(new QFile(path));
+            if(!file->open(mode)) {
+                return std::unique_ptr<QIODevice>();
+            }
+
+            res = res_Ok;
+            return file;
+        }
+
+        //owned as QIODevice from the start, so the return needs no conversion (and no std::move)
+        decompress_device *codec_device = new decompress_device(path, cmp);
+        std::unique_ptr<QIODevice> device(codec_device);
+        if(!codec_device->open_device(mode)) {
+            return std::unique_ptr<QIODevice>();
+        }
+
+        res = res_Ok;
+        return device;
+    }
+
+    std::unique_ptr<QIODevice> open_output(const QString &path, QIODevice::OpenMode mode, EResult &res)
+    {
+        ECompression cmp = compression_from_name(path);
+
+        if(!compression_supported(cmp)) {
+            res = res_UnsupportedCompression;
+            return std::unique_ptr<QIODevice>();
+        }
+
+        res = res_OpenError;
+
+        if(cmp_None == cmp)
+        {
+            std::unique_ptr<QIODevice> file(new QFile(path));
+            if(!file->open(mode)) {
+                return std::unique_ptr<QIODevice>();
+            }
+
+            res = res_Ok;
+            return file;
+        }
+
+        compress_device *codec_device = new compress_device(path, cmp);
+        std::unique_ptr<QIODevice> device(codec_device);
+        if(!codec_device->open_device(mode)) {
+            return std::unique_ptr<QIODevice>();
+        }
+
+        res = res_Ok;
+        return device;
+    }
+
+    EResult close_output(QIODevice &device)
+    {
+        device.close();
+
+        if(compress_device *cd = dynamic_cast<compress_device*>(&device)) {
+            return cd->failed() ? res_WriteError : res_Ok;
+        }
+
+        if(QFileDevice *fd = dynamic_cast<QFileDevice*>(&device)) {
+            return QFileDevice::NoError == fd->error() ? res_Ok : res_WriteError;
+        }
+
+        return res_Ok;
+    }
+}
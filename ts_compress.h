@@ -0,0 +1,39 @@
+#ifndef __ts_compress_h__
+#define __ts_compress_h__
+
+//core
+#include "ts_core.h"
+
+//Qt
+#include <QString>
+#include <QIODevice>
+
+//std
+#include <memory>
+
+//...............................................................................................................
+// Transparent .gz/.zst streams for the file path API.
+// Inputs are detected by magic bytes, outputs by file extension. Data goes through bounded
+// buffers, output compression runs on its own thread so it overlaps the XML work.
+// Support is compiled in with CONFIG += ts_gzip ts_zstd (see ts_core.pri).
+//...............................................................................................................
+
+namespace ts_core
+{
+    enum ECompression { cmp_None = 0, cmp_Gzip, cmp_Zstd };
+
+    ECompression compression_from_name(const QString &path);
+    const char * compression_suffix(ECompression cmp);     //"", ".gz", ".zst"
+    bool compression_supported(ECompression cmp);
+
+    // Opens path for reading/writing, wrapped in a (de)compressing device when needed.
+    // mode may add QIODevice::Text, the file itself is always opened binary when compressed.
+    // Returns nullptr and sets res on failure.
+    std::unique_ptr<QIODevice> open_input(const QString &path, QIODevice::OpenMode mode, EResult &res);
+    std::unique_ptr<QIODevice> open_output(const QString &path, QIODevice::OpenMode mode, EResult &res);
+
+    // Flushes and closes an output from open_output, reports errors of the compression thread.
+    EResult close_output(QIODevice &device);
+}
+
+#endif // __ts_compress_h__
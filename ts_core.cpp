@@ -0,0 +1,674 @@
+﻿#include "ts_core.h"
+#include "ts_compress.h"
+
+//std
+#include <assert.h>
+#include <algorithm>
+#include <sstream>
+#include <memory>
+
+//Qt
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QTextStream>
+#include <QTextCodec>
+#include <QRegularExpression>
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+
+namespace ts_core
+{
+    namespace
+    {
+        //write-only QIODevice forwarding to a sink, lets QXmlStreamWriter/QTextStream write into it
+        struct sink_device : QIODevice
+        {
+            sink_device(sink &s) : m_sink(s) { open(QIODevice::WriteOnly|QIODevice::Unbuffered); }
+
+            virtual bool isSequential() const { return true; }
+
+        protected:
+            virtual qint64 readData(char * /*data*/, qint64 /*maxSize*/) { return -1; }
+            virtual qint64 writeData(const char *data, qint64 size) { return m_sink.write(data, std::size_t(size)) ? size : -1; }
+
+        private:
+            sink &m_sink;
+        };
+
+        message_filter make_filter(const extract_options &opt)
+        {
+            return message_filter(opt.with_unfinished, opt.with_vanished, opt.unfinished_only, opt.context_filter, opt.location_filter);
+        }
+
+        //codec of an XML document from its first bytes: byte order mark, else encoding="..." of the
+        //declaration, else UTF-8. nullptr for an encoding Qt does not know.
+        QTextCodec * xml_codec(const QByteArray &head)
+        {
+            QTextCodec *codec = QTextCodec::codecForUtfText(head, nullptr);
+            if(codec) {
+                return codec;
+            }
+
+            const int decl_end = head.indexOf("?>");
+            const QString decl = QString::fromLatin1(head.constData(), -1 == decl_end ? 0 : decl_end);
+
+            QRegularExpressionMatch rm = QRegularExpression("^\\s*<\\?xml\\s.*\\sencoding\\s*=\\s*[\"']([^\"']+)[\"']").match(decl);
+            return rm.hasMatch() ? QTextCodec::codecForName(rm.captured(1).toLatin1()) : QTextCodec::codecForMib(106);
+        }
+
+        void log_line(std::ostream *log, const std::string &line)
+        {
+            if(log) {
+                *log << line + "\n";
+            }
+        }
+    }
+
+    //...............................................................................................................
+
+    const char * result_text(EResult res)
+    {
+        switch(res)
+        {
+        case res_Ok:                return "Ok";
+        case res_InvalidArguments:  return "Invalid arguments!";
+        case res_InputNotExist:     return "Input file or directory not exist!";
+        case res_InvalidInputDir:   return "Input directory should contain only txt and ts file with same name!";
+        case res_OutputDirNotEmpty: return "Cant create output directory OR directory is not empty!";
+        case res_OpenError:         return "Cant open file!";
+        case res_ParseError:        return "Parsing error!";
+        case res_WriteError:        return "Write error!";
+        case res_UnsupportedCompression: return "Compressed file, but this build has no support for its format!";
+        }
+
+        return "Unknown error!";
+    }
+
+    //...............................................................................................................
+
+    namespace
+    {
+        //builds the tree from reader tokens
+        struct tree_builder
+        {
+            tree_builder(allocator *alloc) : m_alloc(alloc), m_symbols(nullptr), m_states(st_WaitForStartElement) {}
+
+            void token(const QXmlStreamReader &xmlReader, QXmlStreamReader::TokenType tt)
+            {
+                switch(tt)
+                {
+                case QXmlStreamReader::StartDocument:
+                    {
+                        m_root = make_node<document_node>(m_alloc);
+                        m_symbols = &m_root->symbols();
+                        m_current = m_root;
+                    } break;
+                case QXmlStreamReader::DTD:
+                    {
+                        m_current->add_child(make_node<DTD_node>(m_alloc, "<!DOCTYPE TS>"));
+                    } break;
+                case QXmlStreamReader::StartElement:
+                    {
+                        assert(m_states & st_WaitForStartElement);
+                        assert(m_symbols);
+
+                        const symbol_t name = m_symbols->intern(xmlReader.qualifiedName());
+
+                        const QXmlStreamAttributes xmlAttrs = xmlReader.attributes();
+                        m_attrs.clear();
+                        m_attrs.reserve(xmlAttrs.size());
+                        std::for_each(xmlAttrs.begin(), xmlAttrs.end(), [this](const QXmlStreamAttribute &att)
+                        {
+                            m_attrs.push_back(element_node::attribute_t(m_symbols->intern(att.qualifiedName()), m_symbols->intern(att.value())));
+                        });
+
+                        switch(name)
+                        {
+                        case symbol_table::sym_message:
+                            m_current = m_current->add_child(make_node<element_node>(m_alloc, element_node::ent_message, name, m_attrs)); break;
+                        case symbol_table::sym_source:
+                            m_current = m_current->add_child(make_node<element_node>(m_alloc, element_node::ent_source, name, m_attrs)); break;
+                        case symbol_table::sym_translation:
+                            m_current = m_current->add_child(make_node<element_node>(m_alloc, element_node::ent_translation, name, m_attrs)); break;
+                        case symbol_table::sym_TS:
+                            m_current = m_current->add_child(make_node<TS_node>(m_alloc, name, m_attrs)); break;
+                        default:
+                            m_current = m_current->add_child(make_node<element_node>(m_alloc, element_node::ent_element, name, m_attrs)); break;
+                        }
+
+                        m_states = st_WaitForText|st_WaitForStartElement|st_WaitForEndElement;
+                    } break;
+                case QXmlStreamReader::Characters:
+                    {
+                        if(m_states & st_WaitForText)
+                        {
+                            m_text = xmlReader.text().toString();
+                            m_states = st_WaitForEndElement|st_WaitForStartElement;
+                        }
+                    } break;
+                case QXmlStreamReader::EndElement:
+                    {
+                        assert(m_states & st_WaitForEndElement);
+                        assert(m_current->kind() & base_node::nt_Element);
+                        ((element_node*)m_current.get())->set_text(m_text);
+                        m_text.clear();
+                        m_states = st_WaitForStartElement|st_WaitForEndElement;
+                        m_current = m_current->parent();
+                    } break;
+                default: break;
+                }
+            }
+
+            //input text passed through verbatim, appended to the previous raw_node when there is nothing between them
+            void raw(const QString &text)
+            {
+                base_node::base_node_ptr last = m_current->last_child();
+
+                if(last && base_node::nt_Raw == last->kind()) {
+                    ((raw_node*)last.get())->append(text);
+                } else {
+                    m_current->add_child(make_node<raw_node>(m_alloc, text));
+                }
+            }
+
+            //replaces the element just built (a message the filter rejected) with its input text
+            void reject_last(const QString &text)
+            {
+                m_current->remove_last_child();
+                raw(text);
+            }
+
+            //name of the element being built, symbol_table::sym_null at document level
+            symbol_t current_name() const
+            {
+                return (m_current && (m_current->kind() & base_node::nt_Element)) ? ((const element_node*)m_current.get())->name() : symbol_t(symbol_table::sym_null);
+            }
+
+            std::shared_ptr<document_node> m_root;
+
+        private:
+            enum EStates {
+                    st_Unstate = 0
+                ,	st_WaitForStartElement = 0x01
+                ,   st_WaitForText = 0x02
+                ,   st_WaitForEndElement = 0x04
+            };
+
+            allocator *m_alloc;
+            symbol_table *m_symbols;
+            base_node::base_node_ptr m_current;
+            element_node::attributes_t m_attrs;
+            QString m_text;
+            int m_states;
+        };
+    }
+
+    EResult parse_ts(QIODevice &input, base_node::base_node_ptr &root, allocator *alloc, const message_filter *filter)
+    {
+        tree_builder builder(alloc);
+        root.reset();
+
+        if(!filter || !filter->active())
+        {
+            QXmlStreamReader xmlReader(&input);
+
+            while(!xmlReader.atEnd()) {
+                builder.token(xmlReader, xmlReader.readNext());
+            }
+
+            if(xmlReader.hasError() || !builder.m_root) {
+                return res_ParseError;
+            }
+
+            root = builder.m_root;
+            return res_Ok;
+        }
+
+        //Filter pushdown, one pass of one reader: messages of rejected contexts are only skipped, the others
+        //are built while their tokens are read and, when the filter rejects them, replaced by a raw_node with
+        //their input text, which document_dump writes back verbatim. The input goes through in chunks and the
+        //decoded text is kept only back to the markup before the current message.
+        enum { chunk_size = 64 * 1024 };
+
+        QByteArray chunk = input.read(chunk_size);
+        QTextCodec *codec = xml_codec(chunk);
+        if(!codec) {
+            return res_ParseError;
+        }
+
+        std::unique_ptr<QTextDecoder> decoder(codec->makeDecoder());
+        QXmlStreamReader xmlReader;
+        QString window;             //decoded input from window_base on
+        qint64 window_base = 0;
+        bool first_chunk = true;
+
+        //the reader gets the text decoded here (addData(QString) locks its encoding), so its
+        //character offsets are positions in window
+        auto feed = [&]() -> bool
+        {
+            if(chunk.isEmpty()) {
+                chunk = input.read(chunk_size);
+            }
+
+            if(chunk.isEmpty()) {
+                return false;
+            }
+
+            QString text = decoder->toUnicode(chunk);
+            chunk.clear();
+
+            if(first_chunk && text.startsWith(QChar(0xFEFF))) {
+                text.remove(0, 1);
+            }
+            first_chunk = false;
+
+            window += text;
+            xmlReader.addData(text);
+            return true;
+        };
+
+        auto read_next = [&]() -> QXmlStreamReader::TokenType
+        {
+            for(;;)
+            {
+                const QXmlStreamReader::TokenType tt = xmlReader.readNext();
+                if(QXmlStreamReader::Invalid != tt || QXmlStreamReader::PrematureEndOfDocumentError != xmlReader.error() || !feed()) {
+                    return tt;
+                }
+            }
+        };
+
+        auto window_pos = [&]() -> int { return int(xmlReader.characterOffset() - window_base); };
+
+        feed();
+
+        bool context_selected = true, in_context_name = false;
+        QString context_name;
+
+        while(!xmlReader.atEnd())
+        {
+            QXmlStreamReader::TokenType tt = read_next();
+
+            if(QXmlStreamReader::StartElement == tt && QLatin1String("message") == xmlReader.qualifiedName())
+            {
+                //the range is anchored to the tags in the text, the reader offset only says they are behind it.
+                //It starts after the previous markup so the message keeps its indentation.
+                const int tag_begin = window.lastIndexOf(QLatin1String("<message"), window_pos() - 1);
+                if(-1 == tag_begin) {
+                    return res_ParseError;
+                }
+
+                const int raw_begin = window.lastIndexOf('>', tag_begin) + 1;
+
+                symbol_t type = symbol_table::sym_null;
+                bool location_ok = !filter->has_location_filter();
+
+                if(context_selected) {
+                    builder.token(xmlReader, tt);
+                }
+
+                for(int depth = 1; depth && !xmlReader.atEnd(); )
+                {
+                    tt = read_next();
+
+                    if(!context_selected) {
+                        depth += (QXmlStreamReader::StartElement == tt) - (QXmlStreamReader::EndElement == tt);
+                        continue;
+                    }
+
+                    builder.token(xmlReader, tt);
+
+                    if(QXmlStreamReader::StartElement == tt)
+                    {
+                        ++depth;
+
+                        if(!location_ok && QLatin1String("location") == xmlReader.qualifiedName()) {
+                            location_ok = filter->accept_location(xmlReader.attributes().value("filename"));
+                        } else if(QLatin1String("translation") == xmlReader.qualifiedName()) {
+                            type = builder.m_root->symbols().find(xmlReader.attributes().value("type"));
+                        }
+                    }
+                    else if(QXmlStreamReader::EndElement == tt)
+                    {
+                        --depth;
+                    }
+                }
+
+                if(xmlReader.hasError()) {
+                    break;
+                }
+
+                if(!context_selected || !location_ok || !filter->accept_type(type))
+                {
+                    //<message .../> has no end tag
+                    const int end_tag = window.lastIndexOf(QLatin1String("</message"), window_pos() - 1);
+                    const int raw_end = window.indexOf('>', end_tag < tag_begin ? tag_begin : end_tag) + 1;
+
+                    const QString text = window.mid(raw_begin, raw_end - raw_begin);
+                    if(context_selected) {
+                        builder.reject_last(text);
+                    } else {
+                        builder.raw(text);
+                    }
+                }
+
+                continue;
+            }
+
+            //<context><name>...</name> decides for all messages of the context
+            if(QXmlStreamReader::StartElement == tt && QLatin1String("context") == xmlReader.qualifiedName())
+            {
+                context_selected = filter->accept_context(QString());
+            }
+            else if(QXmlStreamReader::StartElement == tt && symbol_table::sym_context == builder.current_name() && QLatin1String("name") == xmlReader.qualifiedName())
+            {
+                in_context_name = true;
+                context_name.clear();
+            }
+            else if(QXmlStreamReader::Characters == tt && in_context_name)
+            {
+                context_name += xmlReader.text();
+            }
+            else if(QXmlStreamReader::EndElement == tt && in_context_name)
+            {
+                in_context_name = false;
+                context_selected = filter->accept_context(context_name);
+            }
+
+            builder.token(xmlReader, tt);
+
+            //nothing before the last markup can become part of a raw range any more
+            const int pos = window_pos();
+            const int keep = 0 < pos ? window.lastIndexOf('>', pos - 1) : -1;
+            if(chunk_size < keep)
+            {
+                window.remove(0, keep);
+                window_base += keep;
+            }
+        }
+
+        if(xmlReader.hasError() || !builder.m_root) {
+            return res_ParseError;
+        }
+
+        root = builder.m_root;
+        return res_Ok;
+    }
+
+    EResult parse_txt(QIODevice &input, visitors::map_QStringQString &strings, std::ostream *log)
+    {
+        QTextStream txts(&input);
+        txts.setCodec("UTF-8");
+
+        const QString rgxp("^(?<id>\\[\\[\\[[A-F0-9]{8}\\]\\]\\])\\s*[\\\",“,”](?<text>.*)[\\\",“,”]$");
+        QRegularExpression rxp(rgxp);
+
+        unsigned int line_counter = 0;
+
+        while(!txts.atEnd())
+        {
+            QString str = txts.readLine();
+            QRegularExpressionMatch rm = rxp.match(str);
+
+            QString id		= rm.captured("id");
+            QString text	= rm.captured("text");
+
+            if(id.isEmpty() || text.isEmpty())
+            {
+                std::ostringstream oss;
+                oss << "Error in line: " << line_counter << " , source line: " << str.toUtf8().constData();
+                log_line(log, oss.str());
+                return res_ParseError;
+            }
+
+            strings.insert(visitors::map_QStringQString::value_type(id, text));
+            line_counter++;
+        }
+
+        return res_Ok;
+    }
+
+    //...............................................................................................................
+
+    EResult extract_tree(base_node::base_node_ptr root, QIODevice &ts_output, QIODevice &txt_output, const extract_options &opt)
+    {
+        using namespace visitors;
+
+        //replace strings
+        map_hashQString strings;
+        const message_filter filter = make_filter(opt);
+        string_extractor_replacer ser(strings, filter);
+        root->visit(ser);
+
+        //write text file
+        QTextStream txts(&txt_output);
+        txts.setCodec("UTF-8");
+
+        std::for_each(strings.begin(), strings.end(), [&txts](const map_hashQString::value_type &vt){ txts << vt.second << "\n"; });
+        txts.flush();
+
+        //write modified ts file
+        QXmlStreamWriter xmlWriter(&ts_output);
+        xmlWriter.setAutoFormatting(true);
+
+        document_dump ddv(xmlWriter);
+        root->visit(ddv);
+
+        return (QTextStream::Ok != txts.status() || ddv.has_error()) ? res_WriteError : res_Ok;
+    }
+
+    EResult merge_tree(base_node::base_node_ptr root, const visitors::map_QStringQString &strings, QIODevice &ts_output, const merge_options &opt)
+    {
+        using namespace visitors;
+
+        //replace strings
+        back_string_replacer bsr(strings, opt.langid, opt.log, opt.checks);
+        root->visit(bsr);
+
+        //dump
+        QXmlStreamWriter xmlWriter(&ts_output);
+        xmlWriter.setAutoFormatting(true);
+        xmlWriter.setCodec("UTF-8");
+
+        document_dump ddv(xmlWriter);
+        root->visit(ddv);
+
+        return ddv.has_error() ? res_WriteError : res_Ok;
+    }
+
+    //...............................................................................................................
+
+    EResult extract(const QByteArray &ts, sink &ts_output, sink &txt_output, const extract_options &opt)
+    {
+        QBuffer input;
+        input.setData(ts);
+        input.open(QIODevice::ReadOnly);
+
+        const message_filter filter = make_filter(opt);
+        base_node::base_node_ptr root;
+        EResult res = parse_ts(input, root, opt.alloc, &filter);
+        if(res_Ok != res) {
+            return res;
+        }
+
+        sink_device tsDevice(ts_output), txtDevice(txt_output);
+        return extract_tree(root, tsDevice, txtDevice, opt);
+    }
+
+    EResult merge(const QByteArray &ts, const QByteArray &txt, sink &ts_output, const merge_options &opt)
+    {
+        QBuffer tsInput;
+        tsInput.setData(ts);
+        tsInput.open(QIODevice::ReadOnly);
+
+        base_node::base_node_ptr root;
+        EResult res = parse_ts(tsInput, root, opt.alloc);
+        if(res_Ok != res) {
+            return res;
+        }
+
+        QBuffer txtInput;
+        txtInput.setData(txt);
+        txtInput.open(QIODevice::ReadOnly|QIODevice::Text);
+
+        visitors::map_QStringQString strings;
+        res = parse_txt(txtInput, strings, opt.log);
+        if(res_Ok != res) {
+            return res;
+        }
+
+        sink_device tsDevice(ts_output);
+        return merge_tree(root, strings, tsDevice, opt);
+    }
+
+    //...............................................................................................................
+
+    EResult extract_files(const QString &inputFile, const QString &outputDir, const extract_options &opt)
+    {
+        QFileInfo fiI(inputFile);
+        if(!fiI.exists()) {
+            return res_InputNotExist;
+        }
+
+        QFileInfo fiO(outputDir);
+        if(!fiO.exists()) {
+            QDir().mkdir(outputDir);
+            fiO.refresh();
+        }
+
+        //outputs keep the compression of the input name: name.ts.gz -> name.ts.gz + name.txt.gz
+        QString outputXmlFileName = QDir(outputDir).path() + "/" + fiI.fileName();
+        QString outputTextFile = QDir(outputDir).path() + "/" + fiI.baseName() + ".txt" + compression_suffix(compression_from_name(inputFile));
+
+        unsigned int files_in_out_dir = QDir(outputDir).entryInfoList(QDir::NoDotAndDotDot|QDir::AllEntries).count();
+
+        if( !fiO.exists()
+            || 2 < files_in_out_dir
+            || (2 == files_in_out_dir && !QFileInfo(outputXmlFileName).exists() && !QFileInfo(outputTextFile).exists()) )
+        {
+            return res_OutputDirNotEmpty;
+        }
+
+        //parse ts file
+        EResult res = res_Ok;
+        std::unique_ptr<QIODevice> iFile = open_input(inputFile, QIODevice::ReadOnly, res);
+        if(!iFile) {
+            return res;
+        }
+
+        const message_filter filter = make_filter(opt);
+        base_node::base_node_ptr root;
+        res = parse_ts(*iFile, root, opt.alloc, &filter);
+        if(res_Ok != res) {
+            return res;
+        }
+
+        std::unique_ptr<QIODevice> oFile = open_output(outputXmlFileName, QIODevice::WriteOnly, res);
+        if(!oFile) {
+            return res;
+        }
+
+        std::unique_ptr<QIODevice> sFile = open_output(outputTextFile, QIODevice::WriteOnly|QIODevice::Text, res);
+        if(!sFile) {
+            return res;
+        }
+
+        res = extract_tree(root, *oFile, *sFile, opt);
+
+        EResult closeRes = close_output(*sFile);
+        if(res_Ok == res) {
+            res = closeRes;
+        }
+
+        closeRes = close_output(*oFile);
+        return res_Ok == res ? closeRes : res;
+    }
+
+    EResult find_merge_inputs(const QString &inputDir, QString &tsFile, QString &txtFile)
+    {
+        QFileInfo fiI(inputDir);
+        if(!fiI.exists()) {
+            return res_InputNotExist;
+        }
+
+        const QFileInfoList &fil = QDir(inputDir).entryInfoList(QDir::NoDotAndDotDot|QDir::AllEntries);
+        unsigned int files_in_input_dir = fil.count();
+
+        tsFile.clear();
+        txtFile.clear();
+
+        if(2 == files_in_input_dir)
+        {
+            //either of them may be compressed: name.ts[.gz|.zst], name.txt[.gz|.zst]
+            const ECompression compressions[] = { cmp_None, cmp_Gzip, cmp_Zstd };
+            const QString base = QDir(inputDir).path() + "/" + fil[0].baseName();
+
+            std::for_each(compressions, compressions + sizeof(compressions)/sizeof(compressions[0]), [&](ECompression cmp)
+            {
+                QFileInfo if0(base + ".ts" + compression_suffix(cmp));
+                QFileInfo if1(base + ".txt" + compression_suffix(cmp));
+
+                if(tsFile.isEmpty() && if0.isFile()) {
+                    tsFile = if0.filePath();
+                }
+
+                if(txtFile.isEmpty() && if1.isFile()) {
+                    txtFile = if1.filePath();
+                }
+            });
+        }
+
+        if(2 < files_in_input_dir || 0 == files_in_input_dir || tsFile.isEmpty() || txtFile.isEmpty()) {
+            return res_InvalidInputDir;
+        }
+
+        return res_Ok;
+    }
+
+    EResult merge_files(const QString &inputDir, const QString &outputFile, const merge_options &opt)
+    {
+        QString tsFile, txtFile;
+        EResult res = find_merge_inputs(inputDir, tsFile, txtFile);
+        if(res_Ok != res) {
+            return res;
+        }
+
+        //parse ts file
+        std::unique_ptr<QIODevice> tsInput = open_input(tsFile, QIODevice::ReadOnly, res);
+        if(!tsInput) {
+            return res;
+        }
+
+        base_node::base_node_ptr root;
+        res = parse_ts(*tsInput, root, opt.alloc);
+        if(res_Ok != res) {
+            return res;
+        }
+
+        //parse txt file
+        std::unique_ptr<QIODevice> txtInput = open_input(txtFile, QIODevice::ReadOnly|QIODevice::Text, res);
+        if(!txtInput) {
+            return res;
+        }
+
+        visitors::map_QStringQString strings;
+        res = parse_txt(*txtInput, strings, opt.log);
+        if(res_Ok != res) {
+            log_line(opt.log, std::string("Parsing error: ") + txtFile.toUtf8().constData() + " !");
+            return res;
+        }
+
+        //dump to file
+        std::unique_ptr<QIODevice> oFile = open_output(outputFile, QIODevice::WriteOnly, res);
+        if(!oFile) {
+            return res;
+        }
+
+        res = merge_tree(root, strings, *oFile, opt);
+
+        EResult closeRes = close_output(*oFile);
+        return res_Ok == res ? closeRes : res;
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef __ts_core_h__
+#define __ts_core_h__
+
+//model
+#include "ts_model.h"
+#include "ts_alloc.h"
+
+//Qt
+#include <QString>
+#include <QByteArray>
+
+//std
+#include <cstddef>
+#include <ostream>
+
+QT_BEGIN_NAMESPACE
+    class QIODevice;
+QT_END_NAMESPACE
+
+//...............................................................................................................
+// ts_core - library API behind the ts_tool command line.
+// Calls keep all of their state on the stack (no globals, no exit(), no QCoreApplication needed),
+// so independent calls can run concurrently from several threads.
+//...............................................................................................................
+
+namespace ts_core
+{
+    enum EResult {
+            res_Ok = 0
+        ,   res_InvalidArguments
+        ,   res_InputNotExist
+        ,   res_InvalidInputDir
+        ,   res_OutputDirNotEmpty
+        ,   res_OpenError
+        ,   res_ParseError
+        ,   res_WriteError
+        ,   res_UnsupportedCompression
+    };
+
+    const char * result_text(EResult res);
+
+    //.........................................................................................
+
+    // Destination for produced bytes. Returning false aborts the call with res_WriteError.
+    struct sink
+    {
+        virtual ~sink() {}
+        virtual bool write(const char *data, std::size_t size) = 0;
+    };
+
+    struct byte_array_sink : sink
+    {
+        byte_array_sink(QByteArray &buffer) : m_buffer(buffer) {}
+        virtual bool write(const char *data, std::size_t size) { m_buffer.append(data, int(size)); return true; }
+
+    private:
+        QByteArray &m_buffer;
+    };
+
+    //.........................................................................................
+
+    struct extract_options
+    {
+        extract_options() : with_unfinished(false), with_vanished(false), unfinished_only(false), alloc(nullptr), log(nullptr) {}
+
+        bool with_unfinished, with_vanished, unfinished_only;
+        QString context_filter;     //wildcard on <context><name>, empty - any
+        QString location_filter;    //wildcard on <location filename>, empty - any
+        allocator *alloc;       //nullptr - default heap
+        std::ostream *log;      //nullptr - no diagnostics
+    };
+
+    struct merge_options
+    {
+        merge_options() : alloc(nullptr), log(nullptr), checks(nullptr) {}
+
+        QString langid;         //empty - leave <TS language> as is
+        allocator *alloc;
+        std::ostream *log;
+        translation_checks *checks;     //nullptr - no checks, otherwise collects the issues of merged translations
+    };
+
+    //.........................................................................................
+    // tree level, devices must be opened by caller
+
+    // With an active filter the messages it rejects are kept as raw_node text of the input and
+    // written back verbatim, so extract_tree only ever sees the selected messages.
+    EResult parse_ts(QIODevice &input, base_node::base_node_ptr &root, allocator *alloc = nullptr, const message_filter *filter = nullptr);
+    EResult parse_txt(QIODevice &input, visitors::map_QStringQString &strings, std::ostream *log = nullptr);
+
+    EResult extract_tree(base_node::base_node_ptr root, QIODevice &ts_output, QIODevice &txt_output, const extract_options &opt);
+    EResult merge_tree(base_node::base_node_ptr root, const visitors::map_QStringQString &strings, QIODevice &ts_output, const merge_options &opt);
+
+    //.........................................................................................
+    // in-memory buffers
+
+    EResult extract(const QByteArray &ts, sink &ts_output, sink &txt_output, const extract_options &opt = extract_options());
+    EResult merge(const QByteArray &ts, const QByteArray &txt, sink &ts_output, const merge_options &opt = merge_options());
+
+    //.........................................................................................
+    // file paths, same layout rules as the command line tool.
+    // .gz/.zst files are (de)compressed on the fly, see ts_compress.h
+
+    EResult extract_files(const QString &inputFile, const QString &outputDir, const extract_options &opt = extract_options());
+    EResult merge_files(const QString &inputDir, const QString &outputFile, const merge_options &opt = merge_options());
+
+    // resolves the .ts/.txt pair merge_files would read from inputDir
+    EResult find_merge_inputs(const QString &inputDir, QString &tsFile, QString &txtFile);
+}
+
+#endif // __ts_core_h__
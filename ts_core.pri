@@ -0,0 +1,32 @@
+# ts_core - conversion library shared by ts_tool (app) and ts_core (lib) targets
+CONFIG += c++11
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/ts_core.cpp \
+    $$PWD/ts_compress.cpp \
+    $$PWD/ts_model.cpp \
+    $$PWD/ts_symbols.cpp \
+    $$PWD/ts_checks.cpp
+
+
+HEADERS += \
+    $$PWD/ts_core.h \
+    $$PWD/ts_compress.h \
+    $$PWD/ts_model.h \
+    $$PWD/ts_alloc.h \
+    $$PWD/ts_symbols.h \
+    $$PWD/ts_checks.h \
+    $$PWD/efl_hash.h
+
+# optional .gz / .zst streams, e.g.: qmake CONFIG+=ts_gzip CONFIG+=ts_zstd
+ts_gzip {
+    DEFINES += TS_WITH_GZIP
+    LIBS += -lz
+}
+
+ts_zstd {
+    DEFINES += TS_WITH_ZSTD
+    LIBS += -lzstd
+}
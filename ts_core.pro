@@ -0,0 +1,42 @@
+TARGET = ts_core
+CONFIG += core xml staticlib
+TEMPLATE = lib
+
+#-------------------------------------------------------------------------------------
+GENF_ROOT   = _output
+LIB_OUTPUT  = $${GENF_ROOT}/_lib
+#-------------------------------------------------------------------------------------
+
+CONFIG(release, debug|release) {
+    BUILD_TYPE = release
+} else {
+    BUILD_TYPE = debug
+}
+
+DESTDIR     = $${LIB_OUTPUT}/$${BUILD_TYPE}
+OBJECTS_DIR = $${GENF_ROOT}/$${TARGET}/$${BUILD_TYPE}/_build
+MOC_DIR     = $${GENF_ROOT}/$${TARGET}/$${BUILD_TYPE}/_moc
+UI_DIR      = $${GENF_ROOT}/$${TARGET}/$${BUILD_TYPE}/_ui
+RCC_DIR     = $${GENF_ROOT}/$${TARGET}/$${BUILD_TYPE}/_rc
+
+##-------------------------------------------------------------------------------------
+
+include(ts_core.pri)
+
+win32-g++{
+    contains(QMAKE_HOST.arch, x86_64) { #x64
+        DEFINES += MINGW_X64
+    } else { #x32
+        DEFINES += MINGW_X32
+    }
+
+    CONFIG(release, debug|release) {
+        #release
+        QMAKE_CXXFLAGS += -std=c++0x -O2 -Os -msse2 -ffp-contract=fast -fpic
+    }
+    else {
+        #debug
+        DEFINES += _DEBUG
+        QMAKE_CXXFLAGS += -std=c++0x -O0 -g3 -msse2 -fpic
+    }
+}
@@ -1,15 +1,58 @@
 ﻿#include "ts_model.h"
+#include "ts_checks.h"
+
+//Qt
+#include <QXmlStreamWriter>
+#include <QIODevice>
 
 //std
 #include <iostream>
+#include <sstream>
 #include <assert.h>
 #include <algorithm>
 
 
+message_filter::message_filter(bool with_unfinished, bool with_vanished, bool unfinished_only
+    , const QString &context_glob, const QString &location_glob)
+    : m_with_unfinished(with_unfinished)
+    , m_with_vanished(with_vanished)
+    , m_unfinished_only(unfinished_only)
+    , m_context(context_glob, Qt::CaseSensitive, QRegExp::WildcardUnix)
+    , m_location(location_glob, Qt::CaseSensitive, QRegExp::WildcardUnix)
+{}
+
+bool message_filter::active() const
+{
+    return m_unfinished_only || !m_with_unfinished || !m_with_vanished || !m_context.isEmpty() || !m_location.isEmpty();
+}
+
+bool message_filter::accept_type(symbol_t type) const
+{
+    if(m_unfinished_only) {
+        return symbol_table::sym_unfinished == type;
+    }
+
+    return !((symbol_table::sym_unfinished == type && !m_with_unfinished)
+            || ((symbol_table::sym_vanished == type || symbol_table::sym_obsolete == type) && !m_with_vanished));
+}
+
+bool message_filter::accept_context(const QString &name) const
+{
+    return m_context.isEmpty() || m_context.exactMatch(name);
+}
+
+bool message_filter::accept_location(const QStringRef &filename) const
+{
+    return m_location.isEmpty() || m_location.exactMatch(filename.toString());
+}
+
+//...............................................................................................................
+
 namespace visitors
 {
     void document_dump::visit(const document_node *node) const
     {
+        m_document = node;
         m_writer.writeStartDocument();
         std::for_each(node->m_childs.begin(), node->m_childs.end(), [this](const base_node::base_node_ptr node){ node->visit(*this); } );
         m_writer.writeEndDocument();
@@ -22,17 +65,42 @@ namespace visitors
 
     void document_dump::visit(const element_node *node) const
     {
-        m_writer.writeStartElement(node->name());
-        m_writer.writeAttributes(node->attributes());
+        assert(m_document);
+        const symbol_table &symbols = m_document->symbols();
+
+        m_writer.writeStartElement(symbols.str(node->name()));
+        std::for_each(node->attributes().begin(), node->attributes().end(), [this, &symbols](const element_node::attribute_t &att)
+        {
+            m_writer.writeAttribute(symbols.str(att.name), symbols.str(att.value));
+        });
         m_writer.writeCharacters(node->text());
         std::for_each(node->m_childs.begin(), node->m_childs.end(), [this](const base_node::base_node_ptr node){ node->visit(*this); } );
         m_writer.writeEndElement();
     }
 
+    void document_dump::visit(const raw_node *node) const
+    {
+        //QXmlStreamWriter has no raw output, but it writes through to the device and the parent
+        //start tag is already closed by writeCharacters(), so the text can go straight to the device.
+        //The text starts with the whitespace before the message, the writer indents what follows by itself.
+        assert(m_writer.device());
+        const QByteArray data = node->text().toUtf8();
+
+        if(data.size() != m_writer.device()->write(data)) {
+            m_raw_error = true;
+        }
+    }
+
+    bool document_dump::has_error() const
+    {
+        return m_raw_error || m_writer.hasError();
+    }
+
     //...............................................................................................................
     
     void string_extractor_replacer::visit(const document_node *node)
     {
+        m_symbols = &node->symbols();
         std::for_each(node->m_childs.begin(), node->m_childs.end(), [this](const base_node::base_node_ptr node){ node->visit(*this); } );
     }
 
@@ -40,9 +108,34 @@ namespace visitors
 
     void string_extractor_replacer::visit(element_node *node)
     {
+        //same selection parse_ts() applies with a filter, for trees parsed without one
+        if(symbol_table::sym_context == node->name())
+        {
+            m_context_selected = m_filter.accept_context(QString());
+        }
+        else if(symbol_table::sym_name == node->name())
+        {
+            base_node::base_node_ptr parent = node->parent();
+            if(parent && (parent->kind() & base_node::nt_Element) && symbol_table::sym_context == ((element_node*)parent.get())->name()) {
+                m_context_selected = m_filter.accept_context(node->text());
+            }
+        }
+
         if(st_WaitForMessage == m_state && element_node::ent_message == node->element_node_type())
         {
             m_state = st_WaitForSource | st_WaitForTranslation;
+
+            assert(m_symbols);
+            m_message_selected = m_context_selected && (!m_filter.has_location_filter()
+                || std::any_of(node->m_childs.begin(), node->m_childs.end(), [this](const base_node::base_node_ptr &child) -> bool
+                {
+                    if(!(child->kind() & base_node::nt_Element) || symbol_table::sym_location != ((element_node*)child.get())->name()) {
+                        return false;
+                    }
+
+                    const QString &filename = m_symbols->str(((element_node*)child.get())->attribute(symbol_table::sym_filename));
+                    return m_filter.accept_location(QStringRef(&filename));
+                }));
         }
         else if(st_WaitForSource & m_state && element_node::ent_source == node->element_node_type())
         {
@@ -77,19 +170,7 @@ namespace visitors
 
         if(st_Complete & m_state)
         {
-            bool bSkipProcessing = false;
-
-            if(!m_with_unfinished || !m_with_vanished || !m_unfinished_only)
-            {
-                QString attr_type = translation->attributes().value("type").toString();
-                if(m_unfinished_only) {
-                    bSkipProcessing = "unfinished" != attr_type;
-                }
-                else {
-                    bSkipProcessing =  ("unfinished" == attr_type && !m_with_unfinished)
-                                    || (("vanished" == attr_type || "obsolete" == attr_type) && !m_with_vanished);
-                }
-            }
+            bool bSkipProcessing = !m_message_selected || !m_filter.accept_type(translation->attribute(symbol_table::sym_type));
 
             if(!bSkipProcessing)
             {
@@ -125,8 +206,9 @@ namespace visitors
 
     //...............................................................................................................
 
-    void back_string_replacer::visit(const document_node *node)
+    void back_string_replacer::visit(document_node *node)
     {
+        m_symbols = &node->symbols();
         std::for_each(node->m_childs.begin(), node->m_childs.end(), [this](const base_node::base_node_ptr node){ node->visit(*this); } );
     }
 
@@ -175,8 +257,13 @@ namespace visitors
 
             if(m_strings.end() == it)
             {
-				std::cerr << "Unprocessed tags <source>: " << source->text().toUtf8().constData() 
-						<< " <translation>: " << translation->text().toUtf8().constData() << std::endl;
+                if(m_log)
+                {
+                    std::ostringstream oss;
+                    oss << "Unprocessed tags <source>: " << source->text().toUtf8().constData() 
+                        << " <translation>: " << translation->text().toUtf8().constData() << std::endl;
+                    *m_log << oss.str();
+                }
             }
             else
             {
@@ -187,6 +274,10 @@ namespace visitors
                 text.replace("\\t", "\t");
 
                 translation->set_text(text);
+
+                if(m_checks) {
+                    m_checks->check(it->first, source->text(), text);
+                }
             }
 
             source = translation = nullptr;
@@ -199,7 +290,8 @@ namespace visitors
 	void back_string_replacer::visit(TS_node *node)
 	{
 		if(!m_langid.isEmpty()) {
-			node->replace_attribute_value("language", m_langid);
+			assert(m_symbols);
+			node->replace_attribute_value(symbol_table::sym_language, m_symbols->intern(m_langid));
 		}
 
 		std::for_each(node->m_childs.begin(), node->m_childs.end(), [this](const base_node::base_node_ptr node)
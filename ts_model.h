@@ -3,22 +3,50 @@
 
 //Qt
 #include <QString>
-#include <QXmlStreamAttributes>
+#include <QRegExp>
 
 //std
 #include <iostream>
 #include <vector>
 #include <map>
 #include <memory>
+#include <algorithm>
 
 //algs
 #include "efl_hash.h"
+#include "ts_symbols.h"
+#include "ts_alloc.h"
 
 QT_BEGIN_NAMESPACE
     class QXmlStreamWriter;
     class QFile;
 QT_END_NAMESPACE
 
+struct translation_checks;
+
+//...............................................................................................................
+// Message selection for TXT mode
+//...............................................................................................................
+
+struct message_filter
+{
+    //empty glob - any context / location
+    message_filter(bool with_unfinished, bool with_vanished, bool unfinished_only
+        , const QString &context_glob = QString(), const QString &location_glob = QString());
+
+    //false when every message is accepted
+    bool active() const;
+
+    bool accept_type(symbol_t type) const;
+    bool accept_context(const QString &name) const;
+    bool accept_location(const QStringRef &filename) const;
+    bool has_location_filter() const { return !m_location.isEmpty(); }
+
+private:
+    bool m_with_unfinished, m_with_vanished, m_unfinished_only;
+    mutable QRegExp m_context, m_location;
+};
+
 //...............................................................................................................
 // Visitors
 //...............................................................................................................
@@ -27,20 +55,27 @@ struct document_node;
 struct DTD_node;
 struct element_node;
 struct TS_node;
+struct raw_node;
 
 namespace visitors
 {
     struct document_dump
     {
-        document_dump(QXmlStreamWriter &writer) : m_writer(writer) {}
+        document_dump(QXmlStreamWriter &writer) : m_writer(writer), m_document(nullptr), m_raw_error(false) {}
 
         void visit(const document_node *node) const;
         void visit(const DTD_node *node) const;
         void visit(const element_node *node) const;
 		void visit(const TS_node *node) const;
+        void visit(const raw_node *node) const;
+
+        //raw_node text bypasses the writer, so QXmlStreamWriter::hasError() alone misses its failures
+        bool has_error() const;
 		
     private:
         QXmlStreamWriter &m_writer;
+        mutable const document_node *m_document;   //symbols of the document being dumped
+        mutable bool m_raw_error;
     };
 
     //.........................................................................................
@@ -52,10 +87,12 @@ namespace visitors
 
     struct string_extractor_replacer
     {
-        string_extractor_replacer(map_hashQString &vqs, bool with_unfinished, bool with_vanished, bool unfinished_only)
+        string_extractor_replacer(map_hashQString &vqs, const message_filter &filter)
             : m_vqs(vqs), source(nullptr), translation(nullptr)
             , m_state(st_WaitForMessage)
-            , m_with_unfinished(with_unfinished), m_with_vanished(with_vanished), m_unfinished_only(unfinished_only)
+            , m_filter(filter)
+            , m_symbols(nullptr)
+            , m_context_selected(true), m_message_selected(true)
         {}
 
         void visit(const document_node *node);
@@ -71,22 +108,27 @@ namespace visitors
 
     private:
          map_hashQString &m_vqs;
-         bool m_with_unfinished, m_with_vanished, m_unfinished_only;
+         const message_filter &m_filter;
+         const symbol_table *m_symbols;
+         bool m_context_selected, m_message_selected;    //by context name and <location filename>, the type is checked per message
     };
 
     //.........................................................................................
 
     struct back_string_replacer
     {
-        back_string_replacer(const map_QStringQString &strings, const QString &langid) 
+        back_string_replacer(const map_QStringQString &strings, const QString &langid, std::ostream *log = &std::cerr, translation_checks *checks = nullptr) 
             : m_strings(strings)
 			, m_langid(langid)
+			, m_log(log)
+			, m_checks(checks)
+			, m_symbols(nullptr)
 			, source(nullptr)
 			, translation(nullptr)
 			, m_state(st_WaitForMessage) 
         {}
 
-        void visit(const document_node *node);
+        void visit(document_node *node);
         void visit(const DTD_node *node);
         void visit(element_node *node);
 		void visit(TS_node *node);
@@ -99,8 +141,11 @@ namespace visitors
         element_node *source, *translation;
 
     private:
-        map_QStringQString m_strings;
+        const map_QStringQString &m_strings;
 		const QString m_langid;
+		std::ostream *m_log;
+		translation_checks *m_checks;   //nullptr - no consistency checks
+		symbol_table *m_symbols;
     };
 }
 
@@ -117,12 +162,14 @@ struct base_node : std::enable_shared_from_this<base_node>
             nt_Document         = 0x10000000
         ,   nt_DTD              = 0x01000000
         ,   nt_Element          = 0x00001000
+        ,   nt_Raw              = 0x00000010
     };
 
     typedef std::shared_ptr<base_node> base_node_ptr;
     typedef std::vector<base_node_ptr> nodes_t;
 
-    base_node() : m_parent(nullptr) {}
+    base_node() {}
+    virtual ~base_node() {}
 
     virtual ENodeType kind() const = 0;
     
@@ -130,28 +177,53 @@ struct base_node : std::enable_shared_from_this<base_node>
 	virtual void visit(visitors::string_extractor_replacer &/*visitor*/) {}
     virtual void visit(visitors::back_string_replacer &visitor) = 0;
 
+    virtual base_node_ptr clone(ts_core::allocator *alloc) const = 0; //deep copy of the subtree through alloc (nullptr - heap), visitors modify trees in place
+
     base_node_ptr     add_child(base_node_ptr ptr)
     {
         m_childs.push_back(ptr);
         ptr->m_parent = shared_from_this();
         return ptr;
     }
-    base_node_ptr parent() const { return m_parent; }
+    base_node_ptr parent() const { return m_parent.lock(); }
+
+    base_node_ptr last_child() const { return m_childs.empty() ? base_node_ptr() : m_childs.back(); }
+    void remove_last_child() { m_childs.back()->m_parent.reset(); m_childs.pop_back(); }
+
+protected:
+    base_node_ptr clone_childs(base_node_ptr copy, ts_core::allocator *alloc) const
+    {
+        std::for_each(m_childs.begin(), m_childs.end(), [&copy, alloc](const base_node_ptr &node){ copy->add_child(node->clone(alloc)); });
+        return copy;
+    }
 
 private:
     nodes_t m_childs;
-    base_node_ptr m_parent;
+    std::weak_ptr<base_node> m_parent; //weak: a strong back reference would keep every tree alive forever
 };
 
 //...............................................................................................................
 
 struct document_node : base_node
 {
-    document_node() : base_node() {}
+    document_node() : base_node(), m_symbols(std::make_shared<symbol_table>()) {}
     virtual ENodeType kind() const { return nt_Document; }
     virtual void visit(const visitors::document_dump &visitor) const { visitor.visit(this); }
     virtual void visit(visitors::string_extractor_replacer &visitor) { visitor.visit(this); }
     virtual void visit(visitors::back_string_replacer &visitor) { visitor.visit(this); }
+
+    virtual base_node_ptr clone(ts_core::allocator *alloc) const
+    {
+        std::shared_ptr<document_node> copy = ts_core::make_node<document_node>(alloc);
+        *copy->m_symbols = *m_symbols;
+        return clone_childs(copy, alloc);
+    }
+
+    symbol_table & symbols() { return *m_symbols; }
+    const symbol_table & symbols() const { return *m_symbols; }
+
+private:
+    std::shared_ptr<symbol_table> m_symbols;
 };
 
 //...............................................................................................................
@@ -163,6 +235,7 @@ struct DTD_node : base_node
     virtual void visit(const visitors::document_dump &visitor) const { visitor.visit(this); }
     virtual void visit(visitors::string_extractor_replacer &visitor) { visitor.visit(this); }
     virtual void visit(visitors::back_string_replacer &visitor) { visitor.visit(this); }
+    virtual base_node_ptr clone(ts_core::allocator *alloc) const { return clone_childs(ts_core::make_node<DTD_node>(alloc, m_systemId), alloc); }
 
     const QString & id() const { return m_systemId; }
 private:
@@ -175,7 +248,16 @@ struct element_node : base_node
 {
     enum EElementNodeType { ent_element, ent_message, ent_source, ent_translation };
 
-    element_node(EElementNodeType ent, const QString &name, const QXmlStreamAttributes &attrs) 
+    struct attribute_t
+    {
+        attribute_t(symbol_t n, symbol_t v) : name(n), value(v) {}
+        symbol_t name, value;
+    };
+
+    //qualified names, namespace URIs are not kept (.ts files do not use them)
+    typedef std::vector<attribute_t> attributes_t;
+
+    element_node(EElementNodeType ent, symbol_t name, const attributes_t &attrs) 
         : m_element_node_type(ent), m_name(name), m_attributes(attrs) 
     {}
     virtual ENodeType kind() const { return nt_Element; }
@@ -183,41 +265,80 @@ struct element_node : base_node
     virtual void visit(visitors::string_extractor_replacer &visitor) { visitor.visit(this); }
     virtual void visit(visitors::back_string_replacer &visitor) { visitor.visit(this); }
 
+    virtual base_node_ptr clone(ts_core::allocator *alloc) const
+    {
+        std::shared_ptr<element_node> copy = ts_core::make_node<element_node>(alloc, m_element_node_type, m_name, m_attributes);
+        copy->set_text(m_text);
+        return clone_childs(copy, alloc);
+    }
+
     EElementNodeType element_node_type() const { return m_element_node_type; }
     
     void set_text(const QString &text) { m_text = text; }
     const QString & text() const { return m_text; }
 
-    const QString & name() const { return m_name; }
-    const QXmlStreamAttributes & attributes() const { return m_attributes; }
+    symbol_t name() const { return m_name; }
+    const attributes_t & attributes() const { return m_attributes; }
+
+    //value id of the attribute, symbol_table::sym_null if there is no such attribute
+    symbol_t attribute(symbol_t name) const
+    {
+        attributes_t::const_iterator it = std::find_if(m_attributes.begin(), m_attributes.end(), [name](const attribute_t &att){ return name == att.name; });
+        return it != m_attributes.end() ? it->value : symbol_t(symbol_table::sym_null);
+    }
     
 protected:
-    QString m_name;
-    QXmlStreamAttributes m_attributes;
-    QString m_text;
     EElementNodeType m_element_node_type;
+    symbol_t m_name;
+    attributes_t m_attributes;
+    QString m_text;
 };
 
 //...............................................................................................................
 
 struct TS_node : element_node
 {
-	TS_node(const QString &name, const QXmlStreamAttributes &attrs)
+	TS_node(symbol_t name, const attributes_t &attrs)
 		: element_node(element_node::ent_element, name, attrs)
 	{}
 
 	virtual void visit(visitors::back_string_replacer &visitor) { visitor.visit(this); }
 
-	void replace_attribute_value(const QString &att_name, const QString &value)
+	virtual base_node_ptr clone(ts_core::allocator *alloc) const
 	{
-		QXmlStreamAttributes::iterator it = std::find_if(m_attributes.begin(), m_attributes.end(), [&att_name](const QXmlStreamAttribute &att){ return att_name == att.name(); });
+		std::shared_ptr<TS_node> copy = ts_core::make_node<TS_node>(alloc, m_name, m_attributes);
+		copy->set_text(m_text);
+		return clone_childs(copy, alloc);
+	}
+
+	void replace_attribute_value(symbol_t att_name, symbol_t value)
+	{
+		attributes_t::iterator it = std::find_if(m_attributes.begin(), m_attributes.end(), [att_name](const attribute_t &att){ return att_name == att.name; });
 
 		if(it != m_attributes.end()) {
-			*it = QXmlStreamAttribute(it->namespaceUri().toString(), it->name().toString(), value);			
+			it->value = value;
 		}
 	}
 };
 
+//...............................................................................................................
+
+// Input text passed through verbatim: messages rejected by message_filter, adjacent ones share one node
+struct raw_node : base_node
+{
+    raw_node(const QString &text) : base_node(), m_text(text) {}
+    virtual ENodeType kind() const { return nt_Raw; }
+    virtual void visit(const visitors::document_dump &visitor) const { visitor.visit(this); }
+    virtual void visit(visitors::back_string_replacer &/*visitor*/) {}
+    virtual base_node_ptr clone(ts_core::allocator *alloc) const { return ts_core::make_node<raw_node>(alloc, m_text); }
+
+    void append(const QString &text) { m_text += text; }
+    const QString & text() const { return m_text; }
+
+private:
+    QString m_text;
+};
+
 
 #endif // TS_MODEL
 
@@ -0,0 +1,70 @@
+﻿#include "ts_symbols.h"
+
+//std
+#include <assert.h>
+
+symbol_table::symbol_table()
+{
+    //SHOULD BE IN SAME ORDER AS in EKnownSymbol
+    static const char * const known[] = {
+            ""
+        ,   "TS"
+        ,   "context"
+        ,   "name"
+        ,   "message"
+        ,   "location"
+        ,   "source"
+        ,   "translation"
+        ,   "filename"
+        ,   "line"
+        ,   "type"
+        ,   "language"
+        ,   "unfinished"
+        ,   "vanished"
+        ,   "obsolete"
+    };
+
+    static_assert(sizeof(known)/sizeof(known[0]) == sym_known_count, "known[] does not match EKnownSymbol");
+
+    m_strings.reserve(sym_known_count);
+    m_strings.push_back(QString());
+
+    for(int n = 1; n < sym_known_count; ++n)
+    {
+        const QString str = QString::fromLatin1(known[n]);
+        symbol_t sym = intern(str);
+        assert(symbol_t(n) == sym);
+        (void)sym;
+    }
+}
+
+symbol_t symbol_table::find(const QStringRef &str) const
+{
+    if(str.isEmpty()) {
+        return sym_null;
+    }
+
+    const uint h = qHash(str);
+    for(QMultiHash<uint, symbol_t>::const_iterator it = m_index.find(h); it != m_index.end() && it.key() == h; ++it)
+    {
+        if(m_strings[it.value()] == str) {
+            return it.value();
+        }
+    }
+
+    return sym_null;
+}
+
+symbol_t symbol_table::intern(const QStringRef &str)
+{
+    symbol_t sym = find(str);
+
+    if(sym_null == sym && !str.isEmpty())
+    {
+        sym = symbol_t(m_strings.size());
+        m_strings.push_back(str.toString());
+        m_index.insert(qHash(str), sym);
+    }
+
+    return sym;
+}
@@ -0,0 +1,58 @@
+#ifndef __ts_symbols_h__
+#define __ts_symbols_h__
+
+//Qt
+#include <QString>
+#include <QStringRef>
+#include <QMultiHash>
+
+//std
+#include <vector>
+
+//...............................................................................................................
+// symbol_table - interned element names, attribute names and attribute values of one document.
+// Nodes keep small integer ids instead of their own string copies, so comparing names or
+// <translation type="..."> values is an integer compare.
+//...............................................................................................................
+
+typedef unsigned int symbol_t;
+
+struct symbol_table
+{
+    //pre-interned, same id in every table
+    enum EKnownSymbol {
+            sym_null = 0            //empty string, also "no such attribute"
+        ,   sym_TS
+        ,   sym_context
+        ,   sym_name
+        ,   sym_message
+        ,   sym_location
+        ,   sym_source
+        ,   sym_translation
+        ,   sym_filename
+        ,   sym_line
+        ,   sym_type
+        ,   sym_language
+        ,   sym_unfinished
+        ,   sym_vanished
+        ,   sym_obsolete
+        ,   sym_known_count
+    };
+
+    symbol_table();
+
+    symbol_t intern(const QStringRef &str);
+    symbol_t intern(const QString &str) { return intern(QStringRef(&str)); }
+
+    //sym_null when str was never interned
+    symbol_t find(const QStringRef &str) const;
+
+    const QString & str(symbol_t sym) const { return m_strings[sym]; }
+    size_t size() const { return m_strings.size(); }
+
+private:
+    std::vector<QString> m_strings;
+    QMultiHash<uint, symbol_t> m_index;     //qHash of the string -> ids, lookups from QStringRef without a temporary QString
+};
+
+#endif // __ts_symbols_h__
@@ -21,14 +21,15 @@ RCC_DIR     = $${GENF_ROOT}/$${TARGET}/$${BUILD_TYPE}/_rc
 
 ##-------------------------------------------------------------------------------------
 
+include(ts_core.pri)
+
 SOURCES += \
     ./main.cpp \
-    ./ts_model.cpp
+    ./ts_watch.cpp
 
 
 HEADERS += \
-    ./ts_model.h \
-    ./efl_hash.h
+    ./ts_watch.h
 
 win32-g++{
     contains(QMAKE_HOST.arch, x86_64) { #x64
@@ -0,0 +1,266 @@
+﻿#include "ts_watch.h"
+#include "ts_compress.h"
+
+//std
+#include <iostream>
+#include <algorithm>
+#include <assert.h>
+
+//Qt
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+
+ts_watcher::ts_watcher(EMode mode, const QStringList &srcs, const QStringList &dsts
+    , const ts_core::extract_options &extract_opt, const ts_core::merge_options &merge_opt
+    , int debounce_ms)
+    : m_mode(mode)
+    , m_srcs(srcs)
+    , m_dsts(dsts)
+    , m_extract_opt(extract_opt)
+    , m_merge_opt(merge_opt)
+{
+    assert(m_srcs.size() == m_dsts.size());
+
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(debounce_ms);
+
+    //every notification restarts the timer, so a burst of writes ends in a single refresh
+    QObject::connect(&m_watcher, &QFileSystemWatcher::fileChanged, [this](const QString &) { m_debounce.start(); });
+    QObject::connect(&m_watcher, &QFileSystemWatcher::directoryChanged, [this](const QString &) { m_debounce.start(); });
+    QObject::connect(&m_debounce, &QTimer::timeout, [this]() { refresh(); });
+}
+
+int ts_watcher::exec()
+{
+    refresh();
+
+    std::for_each(m_srcs.begin(), m_srcs.end(), [](const QString &src)
+    {
+        std::cout << "Watching: " << src.toUtf8().constData() << std::endl;
+    });
+    std::cout << "(Ctrl+C to stop)" << std::endl;
+
+    return QCoreApplication::exec();
+}
+
+ts_watcher::file_stamp ts_watcher::stamp(const QString &path)
+{
+    file_stamp fs;
+    QFileInfo fi(path);
+
+    if(fi.isFile())
+    {
+        fs.modified = fi.lastModified();
+        fs.size = fi.size();
+    }
+
+    return fs;
+}
+
+void ts_watcher::refresh()
+{
+    update_jobs();
+
+    bool merged = false;
+    std::for_each(m_jobs.begin(), m_jobs.end(), [this, &merged](jobs_t::value_type &vt)
+    {
+        if(wm_TXT == m_mode) {
+            refresh_txt(vt.first, vt.second);
+        } else if(refresh_ts(vt.first, vt.second)) {
+            merged = true;
+        }
+    });
+
+    if(merged && m_merged) {
+        m_merged();
+    }
+
+    //editors and lupdate replace files instead of writing in place, which drops the watch
+    rewatch();
+}
+
+void ts_watcher::update_jobs()
+{
+    jobs_t jobs;
+
+    for(int n = 0; n < m_srcs.size(); ++n)
+    {
+        const QString &src = m_srcs[n], &dst = m_dsts[n];
+        QFileInfoList files;
+
+        //TXT mode: a directory of .ts files, one output directory per file
+        if(wm_TXT == m_mode && QFileInfo(src).isDir())
+        {
+            files = QDir(src).entryInfoList(QStringList() << "*.ts" << "*.ts.gz" << "*.ts.zst", QDir::Files, QDir::Name);
+            if(!files.isEmpty()) {
+                QDir().mkpath(dst);
+            }
+        }
+
+        if(files.isEmpty())
+        {
+            jobs[src].dst = dst;
+            continue;
+        }
+
+        std::for_each(files.begin(), files.end(), [&jobs, &dst](const QFileInfo &fi)
+        {
+            jobs[fi.filePath()].dst = QDir(dst).filePath(fi.baseName());
+        });
+    }
+
+    //sources still there keep their stamps and cache, new ones start empty
+    std::for_each(jobs.begin(), jobs.end(), [this](jobs_t::value_type &vt)
+    {
+        jobs_t::iterator it = m_jobs.find(vt.first);
+        if(m_jobs.end() != it && it->second.dst == vt.second.dst) {
+            std::swap(vt.second, it->second);
+        }
+    });
+
+    m_jobs.swap(jobs);
+}
+
+void ts_watcher::refresh_txt(const QString &src, job &j)
+{
+    file_stamp fs = stamp(src);
+    if(fs == j.src_stamp) {
+        return;
+    }
+
+    j.src_stamp = fs;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ts_core::EResult res = ts_core::extract_files(src, j.dst, m_extract_opt);
+
+    if(ts_core::res_Ok == res)
+    {
+        std::cout << "Updated: " << j.dst.toUtf8().constData() << " (" << timer.elapsed() << " ms)" << std::endl;
+    }
+    else
+    {
+        //retry on the next change
+        j.src_stamp = file_stamp();
+        std::cout << src.toUtf8().constData() << ": " << ts_core::result_text(res) << std::endl;
+    }
+}
+
+bool ts_watcher::refresh_ts(const QString &src, job &j)
+{
+    QString tsFile, txtFile;
+    ts_core::EResult res = ts_core::find_merge_inputs(src, tsFile, txtFile);
+    if(ts_core::res_Ok != res)
+    {
+        std::cout << src.toUtf8().constData() << ": " << ts_core::result_text(res) << std::endl;
+        return false;
+    }
+
+    //inputs renamed - forget the cache
+    if(tsFile != j.ts_file || txtFile != j.txt_file)
+    {
+        j.ts_file = tsFile;
+        j.txt_file = txtFile;
+        j.ts_stamp = j.txt_stamp = file_stamp();
+        j.ts_tree.reset();
+        j.strings.clear();
+    }
+
+    file_stamp tsStamp = stamp(j.ts_file), txtStamp = stamp(j.txt_file);
+    if(j.ts_tree && tsStamp == j.ts_stamp && txtStamp == j.txt_stamp) {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if(!j.ts_tree || tsStamp != j.ts_stamp)
+    {
+        j.ts_stamp = tsStamp;
+
+        std::unique_ptr<QIODevice> input = ts_core::open_input(j.ts_file, QIODevice::ReadOnly, res);
+        if(input) {
+            res = ts_core::parse_ts(*input, j.ts_tree, m_merge_opt.alloc);
+        }
+    }
+
+    if(ts_core::res_Ok == res && txtStamp != j.txt_stamp)
+    {
+        j.txt_stamp = txtStamp;
+        j.strings.clear();
+
+        std::unique_ptr<QIODevice> input = ts_core::open_input(j.txt_file, QIODevice::ReadOnly|QIODevice::Text, res);
+        if(input) {
+            res = ts_core::parse_txt(*input, j.strings, m_merge_opt.log);
+        }
+    }
+
+    bool merged = false;
+
+    if(ts_core::res_Ok == res)
+    {
+        std::unique_ptr<QIODevice> output = ts_core::open_output(j.dst, QIODevice::WriteOnly, res);
+        if(output)
+        {
+            merged = true;
+            res = ts_core::merge_tree(j.ts_tree->clone(m_merge_opt.alloc), j.strings, *output, m_merge_opt);
+
+            ts_core::EResult closeRes = ts_core::close_output(*output);
+            if(ts_core::res_Ok == res) {
+                res = closeRes;
+            }
+        }
+    }
+
+    if(ts_core::res_Ok == res)
+    {
+        std::cout << "Updated: " << j.dst.toUtf8().constData() << " (" << timer.elapsed() << " ms)" << std::endl;
+    }
+    else
+    {
+        //retry everything on the next change
+        j.ts_stamp = j.txt_stamp = file_stamp();
+        j.ts_tree.reset();
+        std::cout << src.toUtf8().constData() << ": " << ts_core::result_text(res) << std::endl;
+    }
+
+    return merged;
+}
+
+void ts_watcher::rewatch()
+{
+    QStringList paths;
+
+    std::for_each(m_srcs.begin(), m_srcs.end(), [this, &paths](const QString &src)
+    {
+        paths << src;
+
+        //a single .ts file is replaced, not rewritten, by most tools - its directory reports that
+        if(wm_TXT == m_mode && !QFileInfo(src).isDir()) {
+            paths << QFileInfo(src).absolutePath();
+        }
+    });
+
+    std::for_each(m_jobs.begin(), m_jobs.end(), [this, &paths](const jobs_t::value_type &vt)
+    {
+        if(wm_TXT == m_mode) {
+            paths << vt.first;
+        } else if(!vt.second.ts_file.isEmpty()) {
+            paths << vt.second.ts_file << vt.second.txt_file;
+        }
+    });
+
+    paths.removeDuplicates();
+    const QStringList watched = m_watcher.files() + m_watcher.directories();
+
+    std::for_each(paths.begin(), paths.end(), [this, &watched](const QString &path)
+    {
+        if(QFileInfo(path).exists() && !watched.contains(path)) {
+            m_watcher.addPath(path);
+        }
+    });
+}
@@ -0,0 +1,92 @@
+#ifndef __ts_watch_h__
+#define __ts_watch_h__
+
+//core
+#include "ts_core.h"
+
+//Qt
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+//std
+#include <map>
+#include <functional>
+
+//...............................................................................................................
+// ts_watcher - --watch mode of the command line tool.
+// Watches every --src (a .ts file or a directory of .ts files in TXT mode, a .ts/.txt directory in TS mode),
+// collapses bursts of change notifications into one refresh and re-runs only the conversions whose inputs
+// changed. Each source keeps its own stamps; in TS mode also its parsed .ts tree and .txt strings, so only
+// the input whose stamp changed is parsed again. TXT mode keeps no tree: its only input is the changed .ts.
+// Needs a running QCoreApplication.
+//...............................................................................................................
+
+struct ts_watcher
+{
+    enum EMode { wm_TXT, wm_TS };
+
+    // srcs[n] is converted to dsts[n]. A directory in TXT mode stands for each .ts (.ts.gz, .ts.zst) file
+    // in it, extracted to <dst>/<file base name>.
+    ts_watcher(EMode mode, const QStringList &srcs, const QStringList &dsts
+        , const ts_core::extract_options &extract_opt, const ts_core::merge_options &merge_opt
+        , int debounce_ms = 250);
+
+    // called after each refresh that merged at least one .ts (TS mode), e.g. to report and clear merge_options::checks
+    void on_merged(const std::function<void()> &callback) { m_merged = callback; }
+
+    int exec();
+
+private:
+    struct file_stamp
+    {
+        file_stamp() : size(-1) {}
+
+        bool operator == (const file_stamp &other) const { return size == other.size && modified == other.modified; }
+        bool operator != (const file_stamp &other) const { return !(*this == other); }
+
+        QDateTime modified;
+        qint64 size;
+    };
+
+    //one conversion: a .ts file in TXT mode, a .ts/.txt directory in TS mode
+    struct job
+    {
+        QString dst;
+
+        //TXT mode
+        file_stamp src_stamp;
+
+        //TS mode cache
+        QString ts_file, txt_file;
+        file_stamp ts_stamp, txt_stamp;
+        base_node::base_node_ptr ts_tree;     //pristine, every refresh merges into a clone
+        visitors::map_QStringQString strings;
+    };
+
+    typedef std::map<QString, job> jobs_t;   //by source path
+
+    static file_stamp stamp(const QString &path);
+
+    void refresh();
+    void update_jobs();
+    void refresh_txt(const QString &src, job &j);
+    bool refresh_ts(const QString &src, job &j);     //true when a merge ran
+    void rewatch();
+
+private:
+    EMode m_mode;
+    QStringList m_srcs, m_dsts;
+    ts_core::extract_options m_extract_opt;
+    ts_core::merge_options m_merge_opt;
+
+    QFileSystemWatcher m_watcher;
+    QTimer m_debounce;
+
+    jobs_t m_jobs;
+    std::function<void()> m_merged;
+};
+
+#endif // __ts_watch_h__